@@ -14,15 +14,66 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define KK_HAS_SSE2 1
+#include <emmintrin.h>
+#else
+#define KK_HAS_SSE2 0
+#endif
+
+// The AVX2 path is compiled for any x86-64 target, without enabling AVX2 for the rest of the program, and only
+// runs when the CPU has it (cpuSupportsAvx2()).
+#if defined(__x86_64__) || defined(_M_X64)
+#define KK_HAS_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KK_TARGET_AVX2
+#else
+#define KK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define KK_HAS_AVX2 0
+#endif
+
 //
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <print>
+#include <random>
 #include <set>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #if defined(NDEBUG)
@@ -37,9 +88,41 @@ const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
 const char* const MODEL_PATH = "models/viking_room.obj";
+// Binary mesh cache is written next to the .obj: MODEL_PATH + MESH_CACHE_SUFFIX
+const char* const MESH_CACHE_SUFFIX = ".meshcache";
 const char* const TEXTURE_PATH = "textures/viking_room.png";
+// Texture with pre-built mip chain is written next to the source image: TEXTURE_PATH + TEXTURE_CACHE_SUFFIX
+const char* const TEXTURE_CACHE_SUFFIX = ".texcache";
+// Format used when the texture cache is (re)built at startup; see --bake-texture to pick another one.
+const VkFormat TEXTURE_BAKE_FORMAT = VK_FORMAT_BC7_SRGB_BLOCK;
+// Texture of each material ID; instances of the default scene cycle through them.
+const char* const MATERIAL_TEXTURES[] = {TEXTURE_PATH, "textures/texture.jpg"};
+// Size of the bindless texture table (descriptor indexing); only the first std::size(MATERIAL_TEXTURES) are bound.
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+// Serialized VkPipelineCache: loaded at startup when it was written by the same device and driver, saved at exit.
+const char* const PIPELINE_CACHE_PATH = "shaders/pipeline.cache";
+
+// GLSL of the graphics pipeline and the SPIR-V it is compiled to, as in shaders/compile.cmd. Edits are picked up
+// while the app runs (see startShaderHotReload()); the compiler is %MY_glslc%, same as for compile.cmd, or glslc.
+struct ShaderSource
+{
+    const char* glsl;
+    const char* spirv;
+};
+const char* const SHADER_DIRECTORY = "shaders";
+const ShaderSource VERTEX_SHADER = {"packed_vertex.vert", "vert_packed.spv"};
+const ShaderSource FRAGMENT_SHADER = {"packed_vertex.frag", "frag_packed.spv"};
+const ShaderSource BINDLESS_FRAGMENT_SHADER = {"bindless.frag", "frag_bindless.spv"};
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
+// Fewer draws than this per thread are recorded inline into the primary command buffer instead.
+const std::size_t MIN_DRAWS_PER_RECORDING_THREAD = 256;
+// Persistently mapped host-visible buffer all uploads are staged through; see StagingRing.
+const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+// Per frame in flight: room for uniform data in the persistently mapped uniform buffer; see UniformRing.
+const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 64 * 1024;
+// Size of the VkDeviceMemory blocks buffers and images are sub-allocated from; see DeviceMemoryAllocator.
+const VkDeviceSize MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
 
 const char* const kRequiredValidationLayers[] = {"VK_LAYER_KHRONOS_validation"};
 const char* const kRequiredDeviceExtensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -80,6 +163,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Transfer-only family (DMA queue), if the device exposes one; uploads use graphicsFamily otherwise.
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() const
     {
@@ -94,60 +179,4347 @@ struct SwapChainSupportDetails
     std::vector<VkPresentModeKHR> presentModes{};
 };
 
+// CPU-side vertex as read from the .obj; quantized into PackedVertex before upload.
 struct Vertex
 {
     glm::vec3 pos;
     glm::vec3 color;
     glm::vec2 texCoord;
+};
+
+// GPU vertex: 12 bytes instead of sizeof(Vertex) == 32.
+// Position and texCoord are 16-bit UNORM within the mesh bounds (see MeshQuantization), no color stream.
+struct PackedVertex
+{
+    uint16_t pos[4]; // xyz + padding, R16G16B16_UNORM is not widely supported as a vertex format
+    uint16_t texCoord[2];
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PackedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+};
+static_assert(sizeof(PackedVertex) == 12);
+
+// Per-instance stream (binding 1), advanced once per instance instead of once per vertex.
+// A mat4 attribute takes 4 consecutive locations, one per column.
+struct InstanceData
+{
+    glm::mat4 model;
+    uint32_t material = 0; // index into the texture table
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            attributeDescriptions[column].binding = 1;
+            attributeDescriptions[column].location = 2 + column;
+            attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+        }
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].location = 6;
+        attributeDescriptions[4].format = VK_FORMAT_R32_UINT;
+        attributeDescriptions[4].offset = offsetof(InstanceData, material);
+        return attributeDescriptions;
+    }
+};
+static_assert(sizeof(InstanceData) == 68);
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    bool open(const char* path)
+    {
+        close();
+#if defined(_WIN32)
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0))
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        ptr = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!ptr)
+        {
+            close();
+            return false;
+        }
+        length = std::size_t(fileSize.QuadPart);
+#else
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st{};
+        if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+        {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // mapping keeps its own reference
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+        ptr = static_cast<const unsigned char*>(view);
+        length = std::size_t(st.st_size);
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (ptr)
+        {
+            UnmapViewOfFile(ptr);
+        }
+        if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr)
+        {
+            munmap(const_cast<unsigned char*>(ptr), length);
+        }
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const
+    {
+        return ptr;
+    }
+
+    std::size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const unsigned char* ptr = nullptr;
+    std::size_t length = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// Fast non-cryptographic 64-bit hash, used to detect source file changes.
+uint64_t hashBytes(const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    std::size_t i = 0;
+    for (; (i + 8) <= size; i += 8)
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, bytes + i, 8);
+        h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+        h ^= (h >> 29);
+    }
+    for (; i < size; ++i)
+    {
+        h = (h ^ bytes[i]) * 0xFF51AFD7ED558CCDull;
+    }
+    h ^= (h >> 33);
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= (h >> 33);
+    return h;
+}
+
+// Open-addressing (linear probing) hash table that maps a vertex to its index in the output vertex array.
+// The key is the bit pattern of (pos, texCoord); `color` is not part of it since loadModel() always sets it to white.
+// Slots are 8 bytes (cached hash + index) so a probe sequence usually stays within one cache line; the keys
+// themselves are not copied and are compared against the vertex array directly.
+class VertexDeduplicator
+{
+public:
+    explicit VertexDeduplicator(std::size_t expectedUniqueCount)
+    {
+        slots.resize(std::bit_ceil(std::max<std::size_t>(expectedUniqueCount * 2, 16)));
+    }
+
+    // Returns index of `vertex` in `vertices`, appends it if there is no bitwise-equal vertex yet.
+    uint32_t insert(const Vertex& vertex, std::vector<Vertex>& vertices)
+    {
+        if ((count + 1) * 2 > slots.size()) // keep load factor <= 0.5
+        {
+            grow();
+        }
+
+        const uint32_t hash = hashKey(vertex);
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t i = (hash & mask);; i = ((i + 1) & mask))
+        {
+            Slot& slot = slots[i];
+            if (slot.index == kEmpty)
+            {
+                slot.hash = hash;
+                slot.index = uint32_t(vertices.size());
+                vertices.push_back(vertex);
+                ++count;
+                return slot.index;
+            }
+            if ((slot.hash == hash) && sameKey(vertices[slot.index], vertex))
+            {
+                return slot.index;
+            }
+        }
+    }
+
+    static uint32_t hashKey(const Vertex& vertex)
+    {
+        const uint32_t bits[] = {
+            std::bit_cast<uint32_t>(vertex.pos.x),      //
+            std::bit_cast<uint32_t>(vertex.pos.y),      //
+            std::bit_cast<uint32_t>(vertex.pos.z),      //
+            std::bit_cast<uint32_t>(vertex.texCoord.x), //
+            std::bit_cast<uint32_t>(vertex.texCoord.y), //
+        };
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (uint32_t v : bits)
+        {
+            h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+        }
+        return uint32_t(h ^ (h >> 32));
+    }
+
+    static bool sameKey(const Vertex& lhs, const Vertex& rhs)
+    {
+        return (std::memcmp(&lhs.pos, &rhs.pos, sizeof(lhs.pos)) == 0) //
+               && (std::memcmp(&lhs.texCoord, &rhs.texCoord, sizeof(lhs.texCoord)) == 0);
+    }
+
+private:
+    static constexpr uint32_t kEmpty = uint32_t(-1);
+
+    struct Slot
+    {
+        uint32_t hash = 0;
+        uint32_t index = kEmpty;
+    };
+
+    void grow()
+    {
+        std::vector<Slot> old = std::move(slots);
+        slots.clear();
+        slots.resize(old.size() * 2);
+        const std::size_t mask = slots.size() - 1;
+        for (const Slot& slot : old)
+        {
+            if (slot.index == kEmpty)
+            {
+                continue;
+            }
+            std::size_t i = (slot.hash & mask);
+            while (slots[i].index != kEmpty)
+            {
+                i = ((i + 1) & mask);
+            }
+            slots[i] = slot;
+        }
+    }
+
+    std::vector<Slot> slots;
+    std::size_t count = 0;
+};
+
+// Runs fn(0) .. fn(threadCount - 1) concurrently; fn(0) runs on the calling thread.
+template <typename F>
+void runParallel(unsigned threadCount, F&& fn)
+{
+    std::vector<std::jthread> workers;
+    workers.reserve(threadCount);
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back([&fn, i]() { fn(i); });
+    }
+    fn(0u);
+}
+
+// Persistent threads for work that repeats every frame, where runParallel() would spawn threads each time.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned threadCount)
+    {
+        for (unsigned i = 1; i < threadCount; ++i)
+        {
+            threads_.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        threads_.clear(); // join before the members the workers use go away
+    }
+
+    // Including the calling thread.
+    unsigned threadCount() const
+    {
+        return unsigned(std::size(threads_)) + 1;
+    }
+
+    // Runs fn(0) .. fn(taskCount - 1) on the pool and the calling thread; returns once all of them finished.
+    void run(unsigned taskCount, const std::function<void(unsigned)>& fn)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            // Workers still draining the previous run() must not see this one's counters half-updated.
+            idle_.wait(lock, [this]() { return busy_ == 0; });
+            task_ = &fn;
+            taskCount_ = taskCount;
+            pending_ = taskCount;
+            nextTask_ = 0;
+            ++generation_;
+        }
+        wake_.notify_all();
+        work();
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+private:
+    void work()
+    {
+        for (unsigned task = nextTask_++; task < taskCount_; task = nextTask_++)
+        {
+            (*task_)(task);
+            if (--pending_ == 0)
+            {
+                std::lock_guard lock(mutex_);
+                idle_.notify_all();
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait(lock, [&]() { return stopping_ || (generation_ != seen); });
+                if (stopping_)
+                {
+                    return;
+                }
+                seen = generation_;
+                ++busy_;
+            }
+            work();
+            std::lock_guard lock(mutex_);
+            if (--busy_ == 0)
+            {
+                idle_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::jthread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    bool stopping_ = false;
+    uint64_t generation_ = 0;
+    unsigned busy_ = 0;
+    const std::function<void(unsigned)>* task_ = nullptr;
+    unsigned taskCount_ = 0;
+    std::atomic<unsigned> nextTask_ = 0;
+    std::atomic<unsigned> pending_ = 0;
+};
+
+// Reports files of one directory that were written or moved into it: inotify on Linux, polling of last write
+// times elsewhere.
+class DirectoryWatcher
+{
+public:
+    explicit DirectoryWatcher(const std::string& directory)
+        : directory_(directory)
+    {
+#if defined(_WIN32)
+        scan(nullptr);
+#else
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        KK_VERIFY(fd_ != -1);
+        KK_VERIFY(inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) != -1);
+#endif
+    }
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    ~DirectoryWatcher()
+    {
+#if !defined(_WIN32)
+        ::close(fd_);
+#endif
+    }
+
+    // Waits up to `timeout`; returns names (without the directory) of the files changed since the last call.
+    std::vector<std::string> wait(std::chrono::milliseconds timeout)
+    {
+        std::vector<std::string> changed;
+#if defined(_WIN32)
+        std::this_thread::sleep_for(timeout);
+        scan(&changed);
+#else
+        pollfd request{fd_, POLLIN, 0};
+        if (::poll(&request, 1, int(timeout.count())) <= 0)
+        {
+            return changed;
+        }
+        alignas(inotify_event) char events[4096];
+        for (ssize_t size = ::read(fd_, events, sizeof(events)); size > 0; size = ::read(fd_, events, sizeof(events)))
+        {
+            for (ssize_t offset = 0; offset < size;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+                if ((event->len > 0) && (std::ranges::find(changed, event->name) == std::end(changed)))
+                {
+                    changed.emplace_back(event->name);
+                }
+                offset += ssize_t(sizeof(inotify_event) + event->len);
+            }
+        }
+#endif
+        return changed;
+    }
+
+private:
+#if defined(_WIN32)
+    void scan(std::vector<std::string>* changed)
+    {
+        std::error_code ec;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory_, ec))
+        {
+            const std::filesystem::file_time_type writeTime = entry.last_write_time(ec);
+            if (ec)
+            {
+                continue;
+            }
+            auto [known, inserted] = writeTimes_.try_emplace(entry.path().filename().string(), writeTime);
+            if (!inserted && (known->second != writeTime))
+            {
+                known->second = writeTime;
+                if (changed)
+                {
+                    changed->push_back(known->first);
+                }
+            }
+        }
+    }
+
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes_;
+#else
+    int fd_ = -1;
+#endif
+    std::string directory_;
+};
+
+// SWAR (SIMD within a register) digit helpers: test/convert 8 ASCII digits at once.
+// See Lemire, "Number Parsing at a Gigabyte per Second".
+bool isEightDigits(uint64_t chars)
+{
+    return (((chars & 0xF0F0F0F0F0F0F0F0ull) | (((chars + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+            0x3333333333333333ull);
+}
+
+uint32_t parseEightDigits(uint64_t chars)
+{
+    static_assert(std::endian::native == std::endian::little);
+    chars -= 0x3030303030303030ull;
+    chars = (chars * 10) + (chars >> 8);
+    chars = (((chars & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+                (((chars >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >>
+            32;
+    return uint32_t(chars);
+}
+
+// Accumulates up to 19 significant digits into `mantissa`; fraction digits decrement `exponent`,
+// integer digits that don't fit increment it.
+const char* accumulateDigits(
+    const char* p, const char* end, uint64_t& mantissa, int& significant, int& exponent, bool fraction)
+{
+    while (((end - p) >= 8) && (significant <= 11))
+    {
+        uint64_t chars = 0;
+        std::memcpy(&chars, p, 8);
+        if (!isEightDigits(chars))
+        {
+            break;
+        }
+        mantissa = (mantissa * 100000000) + parseEightDigits(chars);
+        significant += (mantissa != 0) ? 8 : 0;
+        exponent -= fraction ? 8 : 0;
+        p += 8;
+    }
+    for (; (p < end) && (unsigned(*p - '0') < 10); ++p)
+    {
+        if (significant < 19)
+        {
+            mantissa = (mantissa * 10) + unsigned(*p - '0');
+            significant += (mantissa != 0) ? 1 : 0;
+            exponent -= fraction ? 1 : 0;
+        }
+        else if (!fraction)
+        {
+            ++exponent;
+        }
+    }
+    return p;
+}
+
+// Parses "[+-]digits[.digits][(e|E)[+-]digits]"; returns nullptr if there is no number at `p`.
+// Result is within 1 ulp of strtof() for the usual OBJ precision (up to ~15 significant digits).
+const char* parseObjFloat(const char* p, const char* end, float& out)
+{
+    static constexpr double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    const char* const digits = p;
+    p = accumulateDigits(p, end, mantissa, significant, exponent, false);
+    bool hasDigits = (p != digits);
+    if ((p < end) && (*p == '.'))
+    {
+        const char* const fraction = ++p;
+        p = accumulateDigits(p, end, mantissa, significant, exponent, true);
+        hasDigits = hasDigits || (p != fraction);
+    }
+    if (!hasDigits)
+    {
+        return nullptr;
+    }
+    if ((p < end) && ((*p == 'e') || (*p == 'E')))
+    {
+        ++p;
+        bool negativeExponent = false;
+        if ((p < end) && ((*p == '-') || (*p == '+')))
+        {
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+        int e = 0;
+        for (; (p < end) && (unsigned(*p - '0') < 10); ++p)
+        {
+            e = std::min((e * 10) + (*p - '0'), 1000);
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+
+    double value = double(mantissa);
+    if ((exponent >= -22) && (exponent <= 22))
+    {
+        value = (exponent < 0) ? (value / kPow10[-exponent]) : (value * kPow10[exponent]);
+    }
+    else
+    {
+        value *= std::pow(10.0, exponent);
+    }
+    out = float(negative ? -value : value);
+    return p;
+}
+
+const char* parseObjInt(const char* p, const char* end, int& out)
+{
+    bool negative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    const char* const digits = p;
+    int64_t value = 0;
+    for (; (p < end) && (unsigned(*p - '0') < 10); ++p)
+    {
+        value = std::min<int64_t>((value * 10) + (*p - '0'), std::numeric_limits<int>::max());
+    }
+    if (p == digits)
+    {
+        return nullptr;
+    }
+    out = int(negative ? -value : value);
+    return p;
+}
+
+// Result of parsing one line-aligned chunk of an .obj file.
+// Face indices are 0-based; negative (relative) OBJ indices are resolved against the chunk-local
+// attribute count and listed in `relativeIndices` so the merge can add the preceding chunks' counts.
+struct ObjChunk
+{
+    struct RelativeIndex
+    {
+        uint32_t position = 0;  // into `indices`
+        uint32_t component = 0; // 0 - vertex_index, 1 - texcoord_index, 2 - normal_index
+    };
+    struct ShapeStart
+    {
+        std::size_t firstIndex = 0; // into `indices`
+        std::string name;
+    };
+
+    std::vector<float> vertices;
+    std::vector<float> texcoords;
+    std::vector<float> normals;
+    std::vector<tinyobj::index_t> indices; // triangulated
+    std::vector<RelativeIndex> relativeIndices;
+    std::vector<ShapeStart> shapeStarts; // 'o'/'g' statements
+    bool ok = true;
+};
+
+bool isObjSpace(char c)
+{
+    return (c == ' ') || (c == '\t');
+}
+
+const char* skipObjSpaces(const char* p, const char* end)
+{
+    while ((p < end) && isObjSpace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Parses "v", "v/vt", "v//vn" or "v/vt/vn".
+const char* parseObjFaceVertex(const char* p, const char* end, ObjChunk& chunk, tinyobj::index_t& index,
+    std::array<bool, 3>& relative)
+{
+    const int counts[] = {
+        int(chunk.vertices.size() / 3), int(chunk.texcoords.size() / 2), int(chunk.normals.size() / 3)};
+    int* components[] = {&index.vertex_index, &index.texcoord_index, &index.normal_index};
+    index = {-1, -1, -1};
+    relative = {false, false, false};
+    for (int component = 0; component < 3; ++component)
+    {
+        if (component > 0)
+        {
+            if ((p >= end) || (*p != '/'))
+            {
+                break;
+            }
+            ++p;
+            if ((p < end) && (*p == '/'))
+            {
+                continue; // "v//vn"
+            }
+        }
+        int value = 0;
+        p = parseObjInt(p, end, value);
+        if (!p || (value == 0))
+        {
+            return nullptr;
+        }
+        relative[component] = (value < 0);
+        *components[component] = (value > 0) ? (value - 1) : (counts[component] + value);
+    }
+    return p;
+}
+
+void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    std::vector<tinyobj::index_t> face;
+    std::vector<std::array<bool, 3>> faceRelative;
+    while (p < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+        lineEnd = lineEnd ? lineEnd : end;
+        const char* const nextLine = (lineEnd < end) ? (lineEnd + 1) : end;
+        if ((lineEnd > p) && (lineEnd[-1] == '\r'))
+        {
+            --lineEnd;
+        }
+        p = skipObjSpaces(p, lineEnd);
+        if ((lineEnd - p) < 2)
+        {
+            p = nextLine;
+            continue;
+        }
+
+        // The first `required` values must be present; the rest up to `count` default to 0 when the line ends
+        // early, and values past `count` (the "w" of "vt u v w") are ignored.
+        auto parseFloats = [&](const char* s, std::vector<float>& out, int required, int count) {
+            for (int i = 0; i < count; ++i)
+            {
+                float value = 0.0f;
+                s = skipObjSpaces(s, lineEnd);
+                if ((i >= required) && (s == lineEnd))
+                {
+                    out.push_back(value);
+                    continue;
+                }
+                s = parseObjFloat(s, lineEnd, value);
+                if (!s)
+                {
+                    return false;
+                }
+                out.push_back(value);
+            }
+            return true;
+        };
+
+        if ((p[0] == 'v') && isObjSpace(p[1]))
+        {
+            chunk.ok = chunk.ok && parseFloats(p + 2, chunk.vertices, 3, 3);
+        }
+        else if ((p[0] == 'v') && (p[1] == 't') && ((lineEnd - p) > 2) && isObjSpace(p[2]))
+        {
+            chunk.ok = chunk.ok && parseFloats(p + 3, chunk.texcoords, 1, 2);
+        }
+        else if ((p[0] == 'v') && (p[1] == 'n') && ((lineEnd - p) > 2) && isObjSpace(p[2]))
+        {
+            chunk.ok = chunk.ok && parseFloats(p + 3, chunk.normals, 3, 3);
+        }
+        else if ((p[0] == 'f') && isObjSpace(p[1]))
+        {
+            face.clear();
+            faceRelative.clear();
+            const char* s = skipObjSpaces(p + 2, lineEnd);
+            while (s && (s < lineEnd))
+            {
+                tinyobj::index_t index{};
+                std::array<bool, 3> relative{};
+                s = parseObjFaceVertex(s, lineEnd, chunk, index, relative);
+                if (s)
+                {
+                    face.push_back(index);
+                    faceRelative.push_back(relative);
+                    s = skipObjSpaces(s, lineEnd);
+                }
+            }
+            if (!s || (face.size() < 3))
+            {
+                chunk.ok = false;
+            }
+            else
+            {
+                // fan triangulation, same as tinyobj does for convex polygons
+                for (std::size_t i = 2; i < face.size(); ++i)
+                {
+                    for (std::size_t corner : {std::size_t(0), i - 1, i})
+                    {
+                        for (uint32_t component = 0; component < 3; ++component)
+                        {
+                            if (faceRelative[corner][component])
+                            {
+                                chunk.relativeIndices.push_back({uint32_t(chunk.indices.size()), component});
+                            }
+                        }
+                        chunk.indices.push_back(face[corner]);
+                    }
+                }
+            }
+        }
+        else if (((p[0] == 'o') || (p[0] == 'g')) && isObjSpace(p[1]))
+        {
+            const char* name = skipObjSpaces(p + 2, lineEnd);
+            chunk.shapeStarts.push_back({chunk.indices.size(), std::string(name, lineEnd)});
+        }
+        // everything else ("#", "mtllib", "usemtl", "s", "l", ...) is ignored
+        p = nextLine;
+    }
+}
+
+// Multi-threaded replacement for tinyobj::LoadObj (positions, texcoords, normals and triangulated faces only;
+// materials are not loaded). `text` is split into `threadCount` line-aligned chunks parsed concurrently,
+// results are concatenated in file order, so the output does not depend on the thread count.
+bool parseObj(std::string_view text, unsigned threadCount, tinyobj::attrib_t& attrib,
+    std::vector<tinyobj::shape_t>& shapes)
+{
+    threadCount = std::max(1u, threadCount);
+    const char* const begin = text.data();
+    const char* const end = begin + text.size();
+    std::vector<const char*> bounds(threadCount + 1, end);
+    bounds[0] = begin;
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        const char* p = std::max(bounds[i - 1], begin + (text.size() * i / threadCount));
+        while ((p > bounds[i - 1]) && (p < end) && (p[-1] != '\n'))
+        {
+            ++p;
+        }
+        bounds[i] = p;
+    }
+
+    std::vector<ObjChunk> chunks(threadCount);
+    runParallel(threadCount, [&](unsigned i) { parseObjChunk(bounds[i], bounds[i + 1], chunks[i]); });
+
+    struct ChunkBase
+    {
+        std::size_t vertices = 0;
+        std::size_t texcoords = 0;
+        std::size_t normals = 0;
+        std::size_t indices = 0;
+    };
+    std::vector<ChunkBase> bases(threadCount + 1);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        if (!chunks[i].ok)
+        {
+            return false;
+        }
+        bases[i + 1].vertices = bases[i].vertices + chunks[i].vertices.size();
+        bases[i + 1].texcoords = bases[i].texcoords + chunks[i].texcoords.size();
+        bases[i + 1].normals = bases[i].normals + chunks[i].normals.size();
+        bases[i + 1].indices = bases[i].indices + chunks[i].indices.size();
+    }
+
+    attrib = {};
+    attrib.vertices.resize(bases[threadCount].vertices);
+    attrib.texcoords.resize(bases[threadCount].texcoords);
+    attrib.normals.resize(bases[threadCount].normals);
+    std::vector<tinyobj::index_t> indices(bases[threadCount].indices);
+    runParallel(threadCount, [&](unsigned i) {
+        ObjChunk& chunk = chunks[i];
+        const ChunkBase& base = bases[i];
+        std::ranges::copy(chunk.vertices, attrib.vertices.begin() + base.vertices);
+        std::ranges::copy(chunk.texcoords, attrib.texcoords.begin() + base.texcoords);
+        std::ranges::copy(chunk.normals, attrib.normals.begin() + base.normals);
+        std::ranges::copy(chunk.indices, indices.begin() + base.indices);
+        const int offsets[] = {int(base.vertices / 3), int(base.texcoords / 2), int(base.normals / 3)};
+        for (const ObjChunk::RelativeIndex& relative : chunk.relativeIndices)
+        {
+            tinyobj::index_t& index = indices[base.indices + relative.position];
+            int* components[] = {&index.vertex_index, &index.texcoord_index, &index.normal_index};
+            *components[relative.component] += offsets[relative.component];
+        }
+    });
+
+    // Shapes: [first index, name]; faces before the first 'o'/'g' go to an unnamed shape.
+    std::vector<ObjChunk::ShapeStart> shapeStarts = {{0, ""}};
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        for (const ObjChunk::ShapeStart& start : chunks[i].shapeStarts)
+        {
+            shapeStarts.push_back({bases[i].indices + start.firstIndex, start.name});
+        }
+    }
+    shapes.clear();
+    for (std::size_t i = 0; i < shapeStarts.size(); ++i)
+    {
+        const std::size_t first = shapeStarts[i].firstIndex;
+        const std::size_t last = ((i + 1) < shapeStarts.size()) ? shapeStarts[i + 1].firstIndex : indices.size();
+        if (first == last)
+        {
+            continue;
+        }
+        tinyobj::shape_t& shape = shapes.emplace_back();
+        shape.name = shapeStarts[i].name;
+        if ((first == 0) && (last == indices.size()))
+        {
+            shape.mesh.indices = std::move(indices);
+        }
+        else
+        {
+            shape.mesh.indices.assign(indices.begin() + first, indices.begin() + last);
+        }
+        shape.mesh.num_face_vertices.assign((last - first) / 3, 3);
+    }
+
+    // validate only after the merge, when relative indices are resolved
+    const int counts[] = {
+        int(attrib.vertices.size() / 3), int(attrib.texcoords.size() / 2), int(attrib.normals.size() / 3)};
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        for (const tinyobj::index_t& index : shape.mesh.indices)
+        {
+            if ((index.vertex_index < 0) || (index.vertex_index >= counts[0]) //
+                || (index.texcoord_index >= counts[1])                     //
+                || (index.normal_index >= counts[2]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Thread count for parseObj(): roughly one thread per kObjBytesPerThread, up to the number of cores.
+unsigned objParserThreadCount(std::size_t fileSize)
+{
+    const std::size_t kObjBytesPerThread = 1 << 20;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    return unsigned(std::clamp<std::size_t>(fileSize / kObjBytesPerThread, 1, cores));
+}
+
+bool loadObj(const char* path, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+    const std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    return parseObj(text, objParserThreadCount(text.size()), attrib, shapes);
+}
+
+Vertex makeObjVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index)
+{
+    KK_VERIFY(index.vertex_index >= 0);
+    KK_VERIFY(index.texcoord_index >= 0);
+
+    Vertex vertex{};
+    vertex.pos = {
+        attrib.vertices[3 * index.vertex_index + 0], //
+        attrib.vertices[3 * index.vertex_index + 1], //
+        attrib.vertices[3 * index.vertex_index + 2]  //
+    };
+
+    vertex.texCoord = {
+        attrib.texcoords[2 * index.texcoord_index + 0],       //
+        1.0f - attrib.texcoords[2 * index.texcoord_index + 1] // flip
+    };
+
+    vertex.color = {1.0f, 1.0f, 1.0f};
+    return vertex;
+}
+
+std::size_t countObjIndices(const std::vector<tinyobj::shape_t>& shapes)
+{
+    std::size_t count = 0;
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        count += shape.mesh.indices.size();
+    }
+    return count;
+}
+
+// One vertex per OBJ index, no sharing (original tutorial path; kept as a baseline for --bench-dedup).
+void buildExpandedMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+    std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const std::size_t indexCount = countObjIndices(shapes);
+    vertices.reserve(indexCount);
+    indices.reserve(indexCount);
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        for (const tinyobj::index_t& index : shape.mesh.indices)
+        {
+            vertices.push_back(makeObjVertex(attrib, index));
+            indices.push_back(uint32_t(indices.size()));
+        }
+    }
+}
+
+void buildDedupedMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+    std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const std::size_t indexCount = countObjIndices(shapes);
+    // OBJ position count is a good lower bound for the number of unique (pos, texCoord) pairs
+    const std::size_t expectedUnique = std::max(attrib.vertices.size() / 3, attrib.texcoords.size() / 2);
+    VertexDeduplicator dedup(expectedUnique);
+    vertices.reserve(expectedUnique);
+    indices.reserve(indexCount);
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        for (const tinyobj::index_t& index : shape.mesh.indices)
+        {
+            indices.push_back(dedup.insert(makeObjVertex(attrib, index), vertices));
+        }
+    }
+}
+
+// Post-transform vertex cache size assumed by the optimizer and used for ACMR/ATVR.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+// How much worse than its surrounding run a cluster's ACMR may get when splitting for overdraw sorting.
+constexpr float OVERDRAW_CACHE_THRESHOLD = 1.05f;
+
+struct VertexCacheStats
+{
+    double acmr = 0.0; // average cache misses per triangle: 0.5 is ideal, 3.0 is worst case
+    double atvr = 0.0; // average transforms per vertex: 1.0 is ideal
+};
+
+// Simulates a FIFO post-transform cache of `cacheSize` entries over the triangle list.
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, std::size_t vertexCount, uint32_t cacheSize)
+{
+    std::vector<uint32_t> cachedAt(vertexCount, 0); // FIFO position + 1 at the time of insertion, 0 if never
+    uint32_t time = 0;
+    std::size_t misses = 0;
+    std::size_t usedVertices = 0;
+    for (uint32_t vertex : indices)
+    {
+        if ((cachedAt[vertex] == 0) || ((time - cachedAt[vertex]) >= cacheSize))
+        {
+            usedVertices += (cachedAt[vertex] == 0) ? 1 : 0;
+            cachedAt[vertex] = ++time;
+            ++misses;
+        }
+    }
+    VertexCacheStats stats{};
+    if (!indices.empty())
+    {
+        stats.acmr = double(misses) / double(indices.size() / 3);
+        stats.atvr = double(misses) / double(std::max<std::size_t>(usedVertices, 1));
+    }
+    return stats;
+}
+
+// Triangles adjacent to each vertex, as offsets into one flat array.
+struct VertexTriangles
+{
+    std::vector<uint32_t> offsets; // vertexCount + 1
+    std::vector<uint32_t> triangles;
+
+    VertexTriangles(std::span<const uint32_t> indices, std::size_t vertexCount)
+        : offsets(vertexCount + 1, 0)
+        , triangles(indices.size())
+    {
+        for (uint32_t vertex : indices)
+        {
+            ++offsets[vertex + 1];
+        }
+        for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            offsets[vertex + 1] += offsets[vertex];
+        }
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+    }
+
+    std::span<const uint32_t> of(uint32_t vertex) const
+    {
+        return {triangles.data() + offsets[vertex], triangles.data() + offsets[vertex + 1]};
+    }
+};
+
+// Tipsify (Sander, Nehab, Barczak 2007): fans around the most recently used vertex that still has live
+// triangles and will not be evicted before they are emitted. Linear in the number of triangles.
+std::vector<uint32_t> optimizeVertexCache(std::span<const uint32_t> indices, std::size_t vertexCount,
+    uint32_t cacheSize)
+{
+    const VertexTriangles adjacency(indices, vertexCount);
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+    }
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(indices.size() / 3, false);
+    std::vector<uint32_t> deadEnd; // recently referenced vertices, checked when the fan runs dry
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0; // next vertex in input order to restart from
+    int64_t fan = vertexCount > 0 ? 0 : -1;
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (uint32_t triangle : adjacency.of(uint32_t(fan)))
+        {
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            for (std::size_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if ((time - cacheTime[vertex]) > cacheSize)
+                {
+                    cacheTime[vertex] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer the oldest candidate that stays in cache while its remaining triangles are emitted
+        fan = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates)
+        {
+            if (liveTriangles[vertex] == 0)
+            {
+                continue;
+            }
+            int64_t priority = 0;
+            if ((time - cacheTime[vertex] + 2 * liveTriangles[vertex]) <= cacheSize)
+            {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fan = vertex;
+            }
+        }
+        while ((fan < 0) && !deadEnd.empty())
+        {
+            const uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            fan = (liveTriangles[vertex] > 0) ? int64_t(vertex) : -1;
+        }
+        while ((fan < 0) && (cursor < vertexCount))
+        {
+            fan = (liveTriangles[cursor] > 0) ? int64_t(cursor) : -1;
+            ++cursor;
+        }
+    }
+    return result;
+}
+
+// Splits the cache-optimized triangle order into clusters and sorts them so outward-facing clusters are
+// drawn first, which lets early-Z reject more of what follows from any view direction (Sander et al. 2007).
+// Clusters start where the cache restarts cold and wherever the running ACMR drops to `threshold` x the
+// ACMR of the surrounding run, so reordering them costs little vertex cache efficiency.
+void optimizeOverdraw(std::span<const Vertex> vertices, std::vector<uint32_t>& indices, uint32_t cacheSize,
+    float threshold)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // FIFO cache of `cacheSize` entries shared by all passes: a vertex hits when it was loaded after the last
+    // cold restart and fewer than cacheSize misses ago. One timestamp per vertex, allocated once.
+    std::vector<uint32_t> loadedAt(vertices.size(), 0);
+    uint32_t time = 0;
+    uint32_t coldSince = 0;
+    auto triangleMisses = [&](std::size_t triangle) {
+        uint32_t misses = 0;
+        for (std::size_t corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = indices[triangle * 3 + corner];
+            if ((loadedAt[vertex] <= coldSince) || ((time - loadedAt[vertex]) >= cacheSize))
+            {
+                loadedAt[vertex] = ++time;
+                ++misses;
+            }
+        }
+        return misses;
+    };
+
+    // Hard boundaries: triangles whose 3 vertices all miss the cache
+    std::vector<uint32_t> hardStarts;
+    for (std::size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        if ((triangleMisses(triangle) == 3) || (triangle == 0))
+        {
+            hardStarts.push_back(uint32_t(triangle));
+        }
+    }
+    hardStarts.push_back(uint32_t(triangleCount));
+
+    // Soft boundaries inside each hard cluster. Every cluster may end up anywhere after sorting, so each one
+    // is simulated from a cold cache, as is the run it is compared against.
+    std::vector<uint32_t> clusterStarts;
+    for (std::size_t hard = 0; (hard + 1) < hardStarts.size(); ++hard)
+    {
+        const uint32_t begin = hardStarts[hard];
+        const uint32_t end = hardStarts[hard + 1];
+        std::size_t runMisses = 0;
+        coldSince = time;
+        for (uint32_t triangle = begin; triangle < end; ++triangle)
+        {
+            runMisses += triangleMisses(triangle);
+        }
+        const double runAcmr = double(runMisses) / double(end - begin);
+
+        uint32_t clusterStart = begin;
+        std::size_t clusterMisses = 0;
+        coldSince = time;
+        clusterStarts.push_back(begin);
+        for (uint32_t triangle = begin; triangle < end; ++triangle)
+        {
+            clusterMisses += triangleMisses(triangle);
+            const double clusterAcmr = double(clusterMisses) / double(triangle - clusterStart + 1);
+            if (((triangle + 1) < end) && (clusterAcmr <= runAcmr * threshold))
+            {
+                clusterStart = triangle + 1;
+                clusterMisses = 0;
+                coldSince = time;
+                clusterStarts.push_back(clusterStart);
+            }
+        }
+    }
+    clusterStarts.push_back(uint32_t(triangleCount));
+
+    glm::vec3 meshCentroid(0.0f);
+    for (const Vertex& vertex : vertices)
+    {
+        meshCentroid += vertex.pos;
+    }
+    meshCentroid /= float(std::max<std::size_t>(vertices.size(), 1));
+
+    // Occlusion potential: how far the cluster sits from the mesh center along its own average normal
+    const std::size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<float> sortKey(clusterCount);
+    for (std::size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; ++triangle)
+        {
+            const glm::vec3& p0 = vertices[indices[std::size_t(triangle) * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[std::size_t(triangle) * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[std::size_t(triangle) * 3 + 2]].pos;
+            const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0); // length is 2x the triangle area
+            const float triangleArea = glm::length(areaNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+        {
+            centroid /= area;
+        }
+        const float normalLength = glm::length(normal);
+        sortKey[cluster] = (normalLength > 0.0f) ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (std::size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        order[cluster] = uint32_t(cluster);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (uint32_t cluster : order)
+    {
+        sorted.insert(sorted.end(), indices.begin() + std::size_t(clusterStarts[cluster]) * 3,
+            indices.begin() + std::size_t(clusterStarts[cluster + 1]) * 3);
+    }
+    indices = std::move(sorted);
+}
+
+// Renumbers vertices in order of first use so vertex fetches walk memory linearly. Drops unreferenced vertices.
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), kUnused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == kUnused)
+        {
+            remap[index] = uint32_t(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+// Meshlet limits, same as commonly used for mesh shaders; here they bound the culling granularity.
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Contiguous range of the index buffer with bounds for per-cluster culling (model space).
+struct Meshlet
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0; // unique vertices, at most MESHLET_MAX_VERTICES
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+    glm::vec3 center{0.0f}; // bounding sphere
+    float radius = 0.0f;
+    glm::vec3 coneAxis{0.0f, 0.0f, 1.0f}; // average triangle normal
+    float coneCutoff = 2.0f;              // sin of the normal cone half-angle; > 1 never culls
+};
+
+// Computes the bounding sphere and normal cone of `meshlet` from its triangles.
+void computeMeshletBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices, Meshlet& meshlet)
+{
+    const std::span<const uint32_t> meshletIndices = indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+    glm::vec3 minPos = vertices[meshletIndices[0]].pos;
+    glm::vec3 maxPos = minPos;
+    glm::vec3 normalSum(0.0f);
+    std::array<glm::vec3, MESHLET_MAX_TRIANGLES> normals{};
+    std::size_t normalCount = 0;
+    for (std::size_t triangle = 0; triangle < meshletIndices.size(); triangle += 3)
+    {
+        const glm::vec3& p0 = vertices[meshletIndices[triangle + 0]].pos;
+        const glm::vec3& p1 = vertices[meshletIndices[triangle + 1]].pos;
+        const glm::vec3& p2 = vertices[meshletIndices[triangle + 2]].pos;
+        minPos = glm::min(glm::min(minPos, p0), glm::min(p1, p2));
+        maxPos = glm::max(glm::max(maxPos, p0), glm::max(p1, p2));
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals[normalCount++] = normal / length;
+            normalSum += normal / length;
+        }
+    }
+
+    meshlet.boundsMin = minPos;
+    meshlet.boundsMax = maxPos;
+    meshlet.center = (minPos + maxPos) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t index : meshletIndices)
+    {
+        meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, vertices[index].pos));
+    }
+
+    const float axisLength = glm::length(normalSum);
+    if (axisLength <= 0.0f)
+    {
+        return; // no usable normals, never backface-culled
+    }
+    meshlet.coneAxis = normalSum / axisLength;
+    float minDot = 1.0f;
+    for (std::size_t i = 0; i < normalCount; ++i)
+    {
+        minDot = std::min(minDot, glm::dot(normals[i], meshlet.coneAxis));
+    }
+    // Normals spread over a half-space or more: some triangle always faces the camera
+    meshlet.coneCutoff = (minDot <= 0.0f) ? 2.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+// Weight of normal agreement vs. vertex reuse when picking the next meshlet triangle; higher gives tighter cones.
+constexpr float MESHLET_CONE_WEIGHT = 0.5f;
+// Non-adjacent triangles considered when a meshlet runs out of neighbours, and how far (1 - cos) they may turn.
+// The search also stops MESHLET_SEAM_SCAN input triangles past the seed, so skipping triangles emitted by
+// adjacency growth keeps each fallback bounded instead of walking ever longer emitted runs.
+constexpr std::size_t MESHLET_SEAM_WINDOW = 64;
+constexpr std::size_t MESHLET_SEAM_SCAN = 16 * MESHLET_SEAM_WINDOW;
+constexpr float MESHLET_SEAM_SPREAD = 0.1f;
+
+// Grows meshlets of at most MESHLET_MAX_VERTICES unique vertices and MESHLET_MAX_TRIANGLES triangles over
+// triangle adjacency, preferring triangles that add no new vertices and whose normal agrees with the meshlet's.
+// Each meshlet is seeded from, and falls back to, the earliest remaining triangle, so the input
+// (cache/overdraw-optimized) order is kept at meshlet granularity. Rewrites `indices` so every meshlet is a
+// contiguous range.
+std::vector<Meshlet> buildMeshlets(std::span<const Vertex> vertices, std::vector<uint32_t>& indices)
+{
+    const std::size_t triangleCount = indices.size() / 3;
+    const VertexTriangles adjacency(indices, vertices.size());
+    std::vector<glm::vec3> triangleNormals(triangleCount, glm::vec3(0.0f));
+    for (std::size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].pos;
+        const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].pos;
+        const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].pos;
+        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(normal);
+        triangleNormals[triangle] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+    }
+
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> vertexMeshlet(vertices.size(), kNone); // last meshlet that references the vertex
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    std::vector<Meshlet> meshlets;
+
+    std::size_t seed = 0;
+    while (true)
+    {
+        while ((seed < triangleCount) && emitted[seed])
+        {
+            ++seed;
+        }
+        if (seed == triangleCount)
+        {
+            break;
+        }
+
+        const uint32_t id = uint32_t(meshlets.size());
+        Meshlet meshlet{};
+        meshlet.firstIndex = uint32_t(reordered.size());
+        glm::vec3 normalSum(0.0f);
+        candidates.clear();
+        uint32_t next = uint32_t(seed);
+        while (next != kNone)
+        {
+            emitted[next] = true;
+            normalSum += triangleNormals[next];
+            for (std::size_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t vertex = indices[std::size_t(next) * 3 + corner];
+                reordered.push_back(vertex);
+                if (vertexMeshlet[vertex] != id)
+                {
+                    vertexMeshlet[vertex] = id;
+                    ++meshlet.vertexCount;
+                    const std::span<const uint32_t> around = adjacency.of(vertex);
+                    candidates.insert(candidates.end(), around.begin(), around.end());
+                }
+            }
+            meshlet.indexCount += 3;
+            if ((meshlet.indexCount / 3) == MESHLET_MAX_TRIANGLES)
+            {
+                break;
+            }
+
+            const float normalLength = glm::length(normalSum);
+            const glm::vec3 axis = (normalLength > 0.0f) ? normalSum / normalLength : glm::vec3(0.0f);
+            next = kNone;
+            float bestScore = std::numeric_limits<float>::max();
+            std::size_t live = 0;
+            for (uint32_t triangle : candidates)
+            {
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+                candidates[live++] = triangle; // drop emitted triangles from the list as we go
+                uint32_t newVertices = 0;
+                for (std::size_t corner = 0; corner < 3; ++corner)
+                {
+                    newVertices += (vertexMeshlet[indices[std::size_t(triangle) * 3 + corner]] != id) ? 1 : 0;
+                }
+                if ((meshlet.vertexCount + newVertices) > MESHLET_MAX_VERTICES)
+                {
+                    continue;
+                }
+                const float spread = 1.0f - glm::dot(triangleNormals[triangle], axis);
+                const float score = float(newVertices) + MESHLET_CONE_WEIGHT * spread;
+                if (score < bestScore)
+                {
+                    bestScore = score;
+                    next = triangle;
+                }
+            }
+            candidates.resize(live);
+
+            // Adjacency is cut at UV seams: look for a nearby triangle (in input order) facing the same way
+            if (next == kNone)
+            {
+                const std::size_t scanEnd = std::min(triangleCount, seed + MESHLET_SEAM_SCAN);
+                std::size_t scanned = 0;
+                for (std::size_t triangle = seed; (triangle < scanEnd) && (scanned < MESHLET_SEAM_WINDOW); ++triangle)
+                {
+                    if (emitted[triangle])
+                    {
+                        continue;
+                    }
+                    ++scanned;
+                    uint32_t newVertices = 0;
+                    for (std::size_t corner = 0; corner < 3; ++corner)
+                    {
+                        newVertices += (vertexMeshlet[indices[triangle * 3 + corner]] != id) ? 1 : 0;
+                    }
+                    const float spread = 1.0f - glm::dot(triangleNormals[triangle], axis);
+                    if (((meshlet.vertexCount + newVertices) > MESHLET_MAX_VERTICES) || (spread > MESHLET_SEAM_SPREAD))
+                    {
+                        continue;
+                    }
+                    const float score = float(newVertices) + MESHLET_CONE_WEIGHT * spread;
+                    if (score < bestScore)
+                    {
+                        bestScore = score;
+                        next = uint32_t(triangle);
+                    }
+                }
+            }
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    indices = std::move(reordered);
+    for (Meshlet& meshlet : meshlets)
+    {
+        computeMeshletBounds(vertices, indices, meshlet);
+    }
+    return meshlets;
+}
+
+// Sum of squared distances to a set of planes, weighted by triangle area (Garland-Heckbert).
+struct Quadric
+{
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    static Quadric fromTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+    {
+        Quadric q{};
+        const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(areaNormal);
+        if (length <= 0.0)
+        {
+            return q;
+        }
+        const double a = areaNormal.x / length;
+        const double b = areaNormal.y / length;
+        const double c = areaNormal.z / length;
+        const double d = -(a * p0.x + b * p0.y + c * p0.z);
+        const double w = length * 0.5;
+        q.a2 = w * a * a, q.ab = w * a * b, q.ac = w * a * c, q.ad = w * a * d;
+        q.b2 = w * b * b, q.bc = w * b * c, q.bd = w * b * d;
+        q.c2 = w * c * c, q.cd = w * c * d;
+        q.d2 = w * d * d;
+        q.weight = w;
+        return q;
+    }
+
+    void add(const Quadric& q)
+    {
+        a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad, b2 += q.b2, bc += q.bc, bd += q.bd;
+        c2 += q.c2, cd += q.cd, d2 += q.d2, weight += q.weight;
+    }
+
+    // Area-weighted RMS distance from `p` to the planes, in model units.
+    float error(const glm::vec3& p) const
+    {
+        if (weight <= 0.0)
+        {
+            return 0.0f;
+        }
+        const double x = p.x, y = p.y, z = p.z;
+        const double sum = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                         + 2.0 * (ad * x + bd * y + cd * z) + d2;
+        return float(std::sqrt(std::max(sum, 0.0) / weight));
+    }
+};
+
+// For every vertex, the first vertex with a bitwise-equal position: wedges split at UV seams share it.
+std::vector<uint32_t> weldPositions(std::span<const Vertex> vertices)
+{
+    auto positionBits = [&](uint32_t vertex)
+    {
+        const glm::vec3& p = vertices[vertex].pos;
+        return std::array<uint32_t, 3>{
+            std::bit_cast<uint32_t>(p.x), std::bit_cast<uint32_t>(p.y), std::bit_cast<uint32_t>(p.z)};
+    };
+    std::vector<uint32_t> order(vertices.size());
+    for (std::size_t vertex = 0; vertex < order.size(); ++vertex)
+    {
+        order[vertex] = uint32_t(vertex);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&](uint32_t a, uint32_t b) { return positionBits(a) < positionBits(b); });
+
+    std::vector<uint32_t> welded(vertices.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        const bool samePosition = (i > 0) && (positionBits(order[i]) == positionBits(order[i - 1]));
+        welded[order[i]] = samePosition ? welded[order[i - 1]] : order[i];
+    }
+    return welded;
+}
+
+// How simplifyMesh may remove a vertex. Interior vertices collapse onto any neighbor; a seam vertex (two wedges
+// on a UV seam line) collapses only along the seam; locked vertices (open borders, non-manifold edges, seam
+// corners and ends) can be collapsed onto but never removed.
+enum class SimplifyVertexKind : uint8_t
+{
+    Interior,
+    Seam,
+    Locked,
+};
+
+uint64_t undirectedEdgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+// Classifies the vertices referenced by `indices`. `otherWedge` links the two wedges of a seam position and
+// `seamEdges` receives the sorted position-level keys of the edges along seams.
+void classifySimplifyVertices(std::span<const uint32_t> indices, std::span<const uint32_t> welded,
+    std::vector<SimplifyVertexKind>& kinds, std::vector<uint32_t>& otherWedge, std::vector<uint64_t>& seamEdges)
+{
+    const std::size_t vertexCount = welded.size();
+    std::vector<uint32_t> wedgeCount(vertexCount, 0); // indexed by welded position
+    std::vector<uint32_t> firstWedge(vertexCount, UINT32_MAX);
+    std::vector<bool> referenced(vertexCount, false);
+    otherWedge.assign(vertexCount, UINT32_MAX);
+    for (uint32_t vertex : indices)
+    {
+        if (referenced[vertex])
+        {
+            continue;
+        }
+        referenced[vertex] = true;
+        const uint32_t position = welded[vertex];
+        if (wedgeCount[position]++ == 0)
+        {
+            firstWedge[position] = vertex;
+        }
+        else
+        {
+            otherWedge[vertex] = firstWedge[position];
+            otherWedge[firstWedge[position]] = vertex;
+        }
+    }
+
+    // Position and wedge key of every triangle edge: a manifold edge whose two triangles use different wedges
+    // lies on a seam
+    std::vector<std::pair<uint64_t, uint64_t>> edges;
+    edges.reserve(indices.size());
+    for (std::size_t triangle = 0; (triangle + 3) <= indices.size(); triangle += 3)
+    {
+        for (std::size_t corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t a = indices[triangle + corner];
+            const uint32_t b = indices[triangle + (corner + 1) % 3];
+            edges.push_back({undirectedEdgeKey(welded[a], welded[b]), undirectedEdgeKey(a, b)});
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<bool> positionLocked(vertexCount, false);
+    std::vector<uint32_t> seamEdgeCount(vertexCount, 0); // indexed by welded position
+    seamEdges.clear();
+    for (std::size_t first = 0, last = 0; first < edges.size(); first = last)
+    {
+        while ((last < edges.size()) && (edges[last].first == edges[first].first))
+        {
+            ++last;
+        }
+        const uint32_t a = uint32_t(edges[first].first >> 32);
+        const uint32_t b = uint32_t(edges[first].first);
+        if ((last - first) != 2) // border or non-manifold
+        {
+            positionLocked[a] = true;
+            positionLocked[b] = true;
+        }
+        else if (edges[first].second != edges[first + 1].second)
+        {
+            seamEdges.push_back(edges[first].first);
+            ++seamEdgeCount[a];
+            ++seamEdgeCount[b];
+        }
+    }
+
+    kinds.assign(vertexCount, SimplifyVertexKind::Locked);
+    for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const uint32_t position = welded[vertex];
+        if (!referenced[vertex] || positionLocked[position])
+        {
+            continue;
+        }
+        if ((wedgeCount[position] == 1) && (seamEdgeCount[position] == 0))
+        {
+            kinds[vertex] = SimplifyVertexKind::Interior;
+        }
+        else if ((wedgeCount[position] == 2) && (seamEdgeCount[position] == 2))
+        {
+            kinds[vertex] = SimplifyVertexKind::Seam;
+        }
+    }
+}
+
+// Simplifies the triangle list to about `targetIndexCount` indices with half-edge collapses ordered by quadric
+// error, never exceeding `maxError` (model units). Vertices are never moved or created, so every LOD shares the
+// vertex buffer. A seam vertex collapses along its seam with both wedges at once, each onto the wedge of the
+// other end on its side, so UVs stay continuous; see SimplifyVertexKind for what is locked.
+// Returns the simplified indices; `resultError` receives the largest collapse error.
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+    std::size_t targetIndexCount, float maxError, float& resultError)
+{
+    const std::vector<uint32_t> welded = weldPositions(vertices);
+
+    std::vector<Quadric> quadrics(vertices.size()); // indexed by welded position
+    for (std::size_t triangle = 0; (triangle + 3) <= indices.size(); triangle += 3)
+    {
+        const Quadric q = Quadric::fromTriangle(vertices[indices[triangle + 0]].pos,
+            vertices[indices[triangle + 1]].pos, vertices[indices[triangle + 2]].pos);
+        for (std::size_t corner = 0; corner < 3; ++corner)
+        {
+            quadrics[welded[indices[triangle + corner]]].add(q);
+        }
+    }
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    std::vector<Collapse> collapses;
+    std::vector<SimplifyVertexKind> kinds;
+    std::vector<uint32_t> otherWedge;
+    std::vector<uint64_t> seamEdges;
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    resultError = 0.0f;
+    while (result.size() > targetIndexCount)
+    {
+        // Reclassified every pass: seam collapses shorten seams, and their ends move
+        classifySimplifyVertices(result, welded, kinds, otherWedge, seamEdges);
+        auto addCollapse = [&](uint32_t from, uint32_t to)
+        {
+            const bool allowed = (kinds[from] == SimplifyVertexKind::Interior)
+                                 || ((kinds[from] == SimplifyVertexKind::Seam)
+                                     && std::binary_search(seamEdges.begin(), seamEdges.end(),
+                                         undirectedEdgeKey(welded[from], welded[to])));
+            if (allowed)
+            {
+                collapses.push_back({from, to, quadrics[welded[from]].error(vertices[to].pos)});
+            }
+        };
+        collapses.clear();
+        for (std::size_t triangle = 0; triangle < result.size(); triangle += 3)
+        {
+            for (std::size_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t a = result[triangle + corner];
+                const uint32_t b = result[triangle + (corner + 1) % 3];
+                addCollapse(a, b);
+                addCollapse(b, a);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        const VertexTriangles adjacency(result, vertices.size());
+        // The only wedge at `position` that shares a triangle with `vertex`, or UINT32_MAX
+        auto adjacentWedge = [&](uint32_t vertex, uint32_t position)
+        {
+            uint32_t wedge = UINT32_MAX;
+            for (uint32_t triangle : adjacency.of(vertex))
+            {
+                for (std::size_t corner = 0; corner < 3; ++corner)
+                {
+                    const uint32_t other = result[std::size_t(triangle) * 3 + corner];
+                    if (welded[other] != position)
+                    {
+                        continue;
+                    }
+                    if ((wedge != UINT32_MAX) && (wedge != other))
+                    {
+                        return uint32_t(UINT32_MAX);
+                    }
+                    wedge = other;
+                }
+            }
+            return wedge;
+        };
+        // True when moving `from` onto `to` flips a triangle around `from`
+        auto flips = [&](uint32_t from, uint32_t to)
+        {
+            for (uint32_t triangle : adjacency.of(from))
+            {
+                const uint32_t* corners = &result[std::size_t(triangle) * 3];
+                if ((corners[0] == to) || (corners[1] == to) || (corners[2] == to))
+                {
+                    continue; // becomes degenerate and is removed
+                }
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (std::size_t corner = 0; corner < 3; ++corner)
+                {
+                    before[corner] = vertices[corners[corner]].pos;
+                    after[corner] = (corners[corner] == from) ? vertices[to].pos : before[corner];
+                }
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                // Also rejects sharp turns (> ~75 degrees), which otherwise add up to flips over several passes
+                if (glm::dot(normalBefore, normalAfter)
+                    <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        for (std::size_t vertex = 0; vertex < vertices.size(); ++vertex)
+        {
+            remap[vertex] = uint32_t(vertex);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        // Every collapse removes two triangles
+        const std::size_t collapseGoal = (result.size() - targetIndexCount) / 6 + 1;
+        std::size_t collapsed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if ((collapsed >= collapseGoal) || (collapse.error > maxError))
+            {
+                break;
+            }
+            // A seam vertex moves both wedges, each onto the wedge of the other end on its side of the seam
+            uint32_t from[2] = {collapse.from, UINT32_MAX};
+            uint32_t to[2] = {collapse.to, UINT32_MAX};
+            std::size_t moveCount = 1;
+            if (kinds[collapse.from] == SimplifyVertexKind::Seam)
+            {
+                from[1] = otherWedge[collapse.from];
+                to[1] = adjacentWedge(from[1], welded[collapse.to]);
+                moveCount = 2;
+                if ((to[1] == UINT32_MAX) || (adjacentWedge(from[0], welded[collapse.to]) != to[0]))
+                {
+                    continue;
+                }
+            }
+            bool rejected = false;
+            for (std::size_t move = 0; (move < moveCount) && !rejected; ++move)
+            {
+                rejected = touched[from[move]] || touched[to[move]] || flips(from[move], to[move]);
+            }
+            if (rejected)
+            {
+                continue;
+            }
+            for (std::size_t move = 0; move < moveCount; ++move)
+            {
+                // Neighbors of `from` must stay put this pass, otherwise the flip test above is stale
+                for (uint32_t triangle : adjacency.of(from[move]))
+                {
+                    for (std::size_t corner = 0; corner < 3; ++corner)
+                    {
+                        touched[result[std::size_t(triangle) * 3 + corner]] = true;
+                    }
+                }
+                remap[from[move]] = to[move];
+            }
+            quadrics[welded[collapse.to]].add(quadrics[welded[collapse.from]]);
+            resultError = std::max(resultError, collapse.error);
+            ++collapsed;
+        }
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t triangle = 0; triangle < result.size(); triangle += 3)
+        {
+            const uint32_t a = remap[result[triangle + 0]];
+            const uint32_t b = remap[result[triangle + 1]];
+            const uint32_t c = remap[result[triangle + 2]];
+            if ((a != b) && (b != c) && (c != a))
+            {
+                result[kept++] = a;
+                result[kept++] = b;
+                result[kept++] = c;
+            }
+        }
+        result.resize(kept);
+    }
+    return result;
+}
+
+// LOD chain: every level targets LOD_REDUCTION of the previous level's triangles; the chain stops at
+// MAX_LOD_COUNT levels or once simplification stalls (less than LOD_MIN_REDUCTION progress).
+constexpr uint32_t MAX_LOD_COUNT = 6;
+constexpr float LOD_REDUCTION = 0.5f;
+constexpr float LOD_MIN_REDUCTION = 0.9f;
+// Largest simplification error allowed for any level, relative to the mesh AABB diagonal.
+constexpr float LOD_MAX_RELATIVE_ERROR = 0.05f;
+// Screen-space error, in pixels, that the selected LOD may have.
+constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+// A level of detail: a range of meshlets plus the geometric error of the simplification, in model units.
+struct MeshLod
+{
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+// Clip-space planes (Vulkan depth range) in the space `clip` transforms from; inside when dot(plane, p) >= 0.
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    explicit Frustum(const glm::mat4& clip)
+    {
+        const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+        const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+        const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+        const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+        planes = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+        for (glm::vec4& plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        }
+    }
+
+    bool intersectsBox(const glm::vec3& center, const glm::vec3& extent) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w
+                                 + std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y
+                                 + std::abs(plane.z) * extent.z;
+            if (distance < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            if ((plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w) < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Axis-aligned boxes in structure-of-arrays form (center and half-extent), so the culling loops below can
+// test 4 (SSE) or 8 (AVX2) boxes per iteration. Storage is padded to a multiple of kLanes with empty boxes.
+struct AabbSoA
+{
+    static constexpr std::size_t kLanes = 8;
+
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::size_t count = 0;
+
+    void resize(std::size_t boxCount)
+    {
+        count = boxCount;
+        const std::size_t padded = (boxCount + kLanes - 1) / kLanes * kLanes;
+        for (std::vector<float>* lane : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ})
+        {
+            lane->assign(padded, 0.0f);
+        }
+    }
+
+    std::size_t paddedCount() const
+    {
+        return centerX.size();
+    }
+
+    void set(std::size_t box, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        centerX[box] = (boundsMin.x + boundsMax.x) * 0.5f;
+        centerY[box] = (boundsMin.y + boundsMax.y) * 0.5f;
+        centerZ[box] = (boundsMin.z + boundsMax.z) * 0.5f;
+        extentX[box] = (boundsMax.x - boundsMin.x) * 0.5f;
+        extentY[box] = (boundsMax.y - boundsMin.y) * 0.5f;
+        extentZ[box] = (boundsMax.z - boundsMin.z) * 0.5f;
+    }
+};
+
+// A box is outside when it lies entirely behind one plane: dot(n, center) + w + dot(|n|, extent) < 0.
+// Each variant writes visible[i] = 0/1 for all paddedCount() boxes.
+void cullAabbsScalar(const Frustum& frustum, const AabbSoA& boxes, uint8_t* visible)
+{
+    for (std::size_t i = 0; i < boxes.paddedCount(); ++i)
+    {
+        const glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+        const glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+        visible[i] = frustum.intersectsBox(center, extent) ? 1 : 0;
+    }
+}
+
+#if (KK_HAS_SSE2)
+void cullAabbsSse(const Frustum& frustum, const AabbSoA& boxes, uint8_t* visible)
+{
+    for (std::size_t i = 0; i < boxes.paddedCount(); i += 4)
+    {
+        const __m128 centerX = _mm_loadu_ps(&boxes.centerX[i]);
+        const __m128 centerY = _mm_loadu_ps(&boxes.centerY[i]);
+        const __m128 centerZ = _mm_loadu_ps(&boxes.centerZ[i]);
+        const __m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+        const __m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+        const __m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), centerX), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), centerY));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), centerZ));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), extentX));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), extentY));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), extentZ));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+        // all-ones lanes -> 1, then narrow 32 -> 16 -> 8 bits
+        const __m128i ones = _mm_and_si128(_mm_castps_si128(inside), _mm_set1_epi32(1));
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(ones, ones), _mm_setzero_si128());
+        const int32_t packed = _mm_cvtsi128_si32(bytes);
+        std::memcpy(visible + i, &packed, 4);
+    }
+}
+#endif
+
+#if (KK_HAS_AVX2)
+bool cpuSupportsAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4]{};
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || ((_xgetbv(0) & 0x6) != 0x6)) // the OS saves YMM registers
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+KK_TARGET_AVX2 void cullAabbsAvx2(const Frustum& frustum, const AabbSoA& boxes, uint8_t* visible)
+{
+    for (std::size_t i = 0; i < boxes.paddedCount(); i += 8)
+    {
+        const __m256 centerX = _mm256_loadu_ps(&boxes.centerX[i]);
+        const __m256 centerY = _mm256_loadu_ps(&boxes.centerY[i]);
+        const __m256 centerZ = _mm256_loadu_ps(&boxes.centerZ[i]);
+        const __m256 extentX = _mm256_loadu_ps(&boxes.extentX[i]);
+        const __m256 extentY = _mm256_loadu_ps(&boxes.extentY[i]);
+        const __m256 extentZ = _mm256_loadu_ps(&boxes.extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), centerX), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), extentX));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), extentY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), extentZ));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        const __m256i ones = _mm256_and_si256(_mm256_castps_si256(inside), _mm256_set1_epi32(1));
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(ones), _mm256_extracti128_si256(ones, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(visible + i), _mm_packus_epi16(words, words));
+    }
+}
+#endif
+
+// Widest variant this build and CPU support.
+void cullAabbs(const Frustum& frustum, const AabbSoA& boxes, uint8_t* visible)
+{
+#if (KK_HAS_AVX2)
+    static const bool avx2 = cpuSupportsAvx2();
+    if (avx2)
+    {
+        cullAabbsAvx2(frustum, boxes, visible);
+        return;
+    }
+#endif
+#if (KK_HAS_SSE2)
+    cullAabbsSse(frustum, boxes, visible);
+#else
+    cullAabbsScalar(frustum, boxes, visible);
+#endif
+}
+
+// True when every triangle of the meshlet faces away from `cameraPosition` (model space).
+bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+{
+    const glm::vec3 toCenter = meshlet.center - cameraPosition;
+    return glm::dot(toCenter, meshlet.coneAxis) >= (meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius);
+}
+
+// Dequantization: value = offset + scale * unorm. Passed to the vertex shader through the UBO.
+struct MeshQuantization
+{
+    glm::vec3 positionOffset{0.0f};
+    glm::vec3 positionScale{1.0f};
+    glm::vec2 texCoordOffset{0.0f};
+    glm::vec2 texCoordScale{1.0f};
+};
+
+uint16_t quantizeUnorm16(float value, float offset, float scale)
+{
+    if (scale <= 0.0f)
+    {
+        return 0; // degenerate axis: every vertex sits at `offset`
+    }
+    const float unorm = std::clamp((value - offset) / scale, 0.0f, 1.0f);
+    return uint16_t(std::lround(unorm * 65535.0f));
+}
+
+// Fits 16-bit grids to the position and texCoord AABBs of the mesh. Max error is half a step of the extent.
+MeshQuantization quantizeMesh(std::span<const Vertex> vertices, std::vector<PackedVertex>& packed)
+{
+    MeshQuantization quantization{};
+    if (vertices.empty())
+    {
+        return quantization;
+    }
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    glm::vec2 minUV = vertices[0].texCoord;
+    glm::vec2 maxUV = vertices[0].texCoord;
+    for (const Vertex& vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+        minUV = glm::min(minUV, vertex.texCoord);
+        maxUV = glm::max(maxUV, vertex.texCoord);
+    }
+    quantization.positionOffset = minPos;
+    quantization.positionScale = maxPos - minPos;
+    quantization.texCoordOffset = minUV;
+    quantization.texCoordScale = maxUV - minUV;
+
+    const MeshQuantization& q = quantization;
+    packed.resize(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            out.pos[axis] = quantizeUnorm16(vertex.pos[axis], q.positionOffset[axis], q.positionScale[axis]);
+        }
+        out.pos[3] = 0;
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            out.texCoord[axis] = quantizeUnorm16(vertex.texCoord[axis], q.texCoordOffset[axis], q.texCoordScale[axis]);
+        }
+    }
+    return quantization;
+}
+
+// Range of the index buffer drawn with one vkCmdDrawIndexed.
+struct MeshChunk
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0; // added to every index of the chunk by the GPU
+
+    bool operator==(const MeshChunk&) const = default;
+};
+
+// Everything needed to upload and draw a mesh; views either loadModel() vectors or the mapped mesh cache.
+struct MeshView
+{
+    std::span<const PackedVertex> vertices;
+    std::span<const unsigned char> indices; // uint16_t or uint32_t, see indexType
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::span<const MeshChunk> chunks;
+    std::span<const Meshlet> meshlets;
+    std::span<const MeshLod> lods; // finest first
+    MeshQuantization quantization{};
+
+    uint32_t indexStride() const
+    {
+        return (indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    std::size_t indexCount() const
+    {
+        return indices.size() / indexStride();
+    }
+};
+
+// Number of vertices a chunk can address with 16-bit indices (no primitive restart, so 0xFFFF is valid).
+constexpr std::size_t kMaxIndex16Vertices = std::size_t(std::numeric_limits<uint16_t>::max()) + 1;
+
+// Splits the mesh into chunks that reference at most kMaxIndex16Vertices vertices each, cutting only between
+// meshlets. Vertices used by several chunks are duplicated into each of them; meshlet vertexOffsets follow.
+void splitMeshForIndex16(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices,
+    std::span<Meshlet> meshlets, std::vector<PackedVertex>& chunkVertices, std::vector<uint16_t>& chunkIndices,
+    std::vector<MeshChunk>& chunks)
+{
+    constexpr uint32_t kNotInChunk = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(vertices.size(), kNotInChunk); // global vertex -> index within current chunk
+    std::vector<uint32_t> chunkUsed;                           // global vertices of the current chunk
+    chunkVertices.reserve(vertices.size());
+    chunkIndices.reserve(indices.size());
+
+    MeshChunk chunk{};
+    auto startChunk = [&]()
+    {
+        if (chunk.indexCount > 0)
+        {
+            chunks.push_back(chunk);
+        }
+        chunk.firstIndex = uint32_t(chunkIndices.size());
+        chunk.indexCount = 0;
+        chunk.vertexOffset = int32_t(chunkVertices.size());
+        for (uint32_t vertex : chunkUsed)
+        {
+            remap[vertex] = kNotInChunk;
+        }
+        chunkUsed.clear();
+    };
+
+    startChunk();
+    for (Meshlet& meshlet : meshlets)
+    {
+        if ((chunkUsed.size() + meshlet.vertexCount) > kMaxIndex16Vertices)
+        {
+            startChunk();
+        }
+        for (uint32_t vertex : indices.subspan(meshlet.firstIndex, meshlet.indexCount))
+        {
+            if (remap[vertex] == kNotInChunk)
+            {
+                remap[vertex] = uint32_t(chunkUsed.size());
+                chunkUsed.push_back(vertex);
+                chunkVertices.push_back(vertices[vertex]);
+            }
+            chunkIndices.push_back(uint16_t(remap[vertex]));
+        }
+        chunk.indexCount += meshlet.indexCount;
+        meshlet.vertexOffset = chunk.vertexOffset;
+    }
+    startChunk();
+}
+
+// On-disk layout of the binary mesh cache: header, then vertex, index, chunk, meshlet and LOD payloads.
+// Payloads are stored exactly as uploaded to the GPU so they can be copied to a staging buffer as is.
+// Bump kVersion whenever PackedVertex layout or mesh processing in loadModel() changes.
+struct MeshCacheHeader
+{
+    static constexpr uint32_t kMagic = 0x434D4B56; // "VKMC"
+    static constexpr uint32_t kVersion = 9;
+    static constexpr uint64_t kPayloadAlignment = 16;
+
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint64_t sourceHash = 0; // hashBytes() of the .obj file
+    uint32_t vertexStride = sizeof(PackedVertex);
+    uint32_t indexStride = sizeof(uint32_t); // 2 or 4
+    uint64_t vertexCount = 0;
+    uint64_t indexCount = 0;
+    uint64_t chunkCount = 0;
+    uint64_t meshletCount = 0;
+    uint64_t lodCount = 0;
+    uint64_t vertexOffset = 0;
+    uint64_t indexOffset = 0;
+    uint64_t chunkOffset = 0;
+    uint64_t meshletOffset = 0;
+    uint64_t lodOffset = 0;
+    MeshQuantization quantization{};
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Validates mapped cache against `sourceHash`; on success `mesh` views the mapping.
+bool viewMeshCache(const MappedFile& cache, uint64_t sourceHash, MeshView& mesh)
+{
+    MeshCacheHeader header{};
+    if (cache.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, cache.data(), sizeof(header));
+    const MeshCacheHeader expected{};
+    if ((header.magic != expected.magic)                                                         //
+        || (header.version != expected.version)                                                  //
+        || (header.vertexStride != expected.vertexStride)                                        //
+        || ((header.indexStride != sizeof(uint16_t)) && (header.indexStride != sizeof(uint32_t))) //
+        || (header.sourceHash != sourceHash))
+    {
+        return false;
+    }
+    // Division instead of offset + count * stride, which a corrupt count can overflow
+    auto fits = [&](uint64_t offset, uint64_t count, uint64_t stride)
+    {
+        return ((offset % MeshCacheHeader::kPayloadAlignment) == 0) && (offset <= cache.size())
+               && (count <= ((cache.size() - offset) / stride));
+    };
+    if (!fits(header.vertexOffset, header.vertexCount, sizeof(PackedVertex)) //
+        || !fits(header.indexOffset, header.indexCount, header.indexStride)  //
+        || !fits(header.chunkOffset, header.chunkCount, sizeof(MeshChunk))   //
+        || !fits(header.meshletOffset, header.meshletCount, sizeof(Meshlet)) //
+        || !fits(header.lodOffset, header.lodCount, sizeof(MeshLod))         //
+        || (header.lodCount == 0) || (header.lodCount > MAX_LOD_COUNT))
+    {
+        return false;
+    }
+    // Every range drawn from the cache must stay inside the index, vertex and meshlet payloads
+    auto validRange = [&](uint64_t firstIndex, uint64_t indexCount, int32_t vertexOffset)
+    {
+        return ((firstIndex + indexCount) <= header.indexCount) && (vertexOffset >= 0)
+               && (uint64_t(vertexOffset) < header.vertexCount);
+    };
+    const std::span<const MeshChunk> chunks{
+        reinterpret_cast<const MeshChunk*>(cache.data() + header.chunkOffset), std::size_t(header.chunkCount)};
+    const std::span<const Meshlet> meshlets{
+        reinterpret_cast<const Meshlet*>(cache.data() + header.meshletOffset), std::size_t(header.meshletCount)};
+    const std::span<const MeshLod> lods{
+        reinterpret_cast<const MeshLod*>(cache.data() + header.lodOffset), std::size_t(header.lodCount)};
+    for (const MeshChunk& chunk : chunks)
+    {
+        if (!validRange(chunk.firstIndex, chunk.indexCount, chunk.vertexOffset))
+        {
+            return false;
+        }
+    }
+    for (const Meshlet& meshlet : meshlets)
+    {
+        if (!validRange(meshlet.firstIndex, meshlet.indexCount, meshlet.vertexOffset))
+        {
+            return false;
+        }
+    }
+    for (const MeshLod& lod : lods)
+    {
+        if ((lod.meshletCount == 0) || ((uint64_t(lod.firstMeshlet) + lod.meshletCount) > header.meshletCount))
+        {
+            return false;
+        }
+    }
+    mesh.vertices = {reinterpret_cast<const PackedVertex*>(cache.data() + header.vertexOffset),
+        std::size_t(header.vertexCount)};
+    mesh.indices = {cache.data() + header.indexOffset, std::size_t(header.indexCount * header.indexStride)};
+    mesh.indexType = (header.indexStride == sizeof(uint16_t)) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    mesh.chunks = chunks;
+    mesh.meshlets = meshlets;
+    mesh.lods = lods;
+    mesh.quantization = header.quantization;
+    return true;
+}
+
+// Writes to a temporary file first and renames it, so a crash never leaves a truncated file behind.
+bool writeFileAtomically(const std::string& path, std::span<const unsigned char> bytes)
+{
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+        if (!file)
+        {
+            std::println(stderr, "Failed to write '{}'", tmpPath);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::println(stderr, "Failed to rename '{}': {}", tmpPath, ec.message());
+        return false;
+    }
+    return true;
+}
+
+void writeMeshCache(const std::string& path, uint64_t sourceHash, const MeshView& mesh)
+{
+    MeshCacheHeader header{};
+    header.sourceHash = sourceHash;
+    header.quantization = mesh.quantization;
+    header.indexStride = mesh.indexStride();
+    header.vertexCount = mesh.vertices.size();
+    header.indexCount = mesh.indexCount();
+    header.chunkCount = mesh.chunks.size();
+    header.meshletCount = mesh.meshlets.size();
+    header.lodCount = mesh.lods.size();
+    header.vertexOffset = alignUp(sizeof(header), MeshCacheHeader::kPayloadAlignment);
+    header.indexOffset = alignUp(header.vertexOffset + mesh.vertices.size_bytes(), MeshCacheHeader::kPayloadAlignment);
+    header.chunkOffset = alignUp(header.indexOffset + mesh.indices.size_bytes(), MeshCacheHeader::kPayloadAlignment);
+    header.meshletOffset = alignUp(header.chunkOffset + mesh.chunks.size_bytes(), MeshCacheHeader::kPayloadAlignment);
+
+    header.lodOffset = alignUp(header.meshletOffset + mesh.meshlets.size_bytes(), MeshCacheHeader::kPayloadAlignment);
+
+    std::vector<unsigned char> bytes(header.lodOffset + mesh.lods.size_bytes());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.vertexOffset, mesh.vertices.data(), mesh.vertices.size_bytes());
+    std::memcpy(bytes.data() + header.indexOffset, mesh.indices.data(), mesh.indices.size_bytes());
+    std::memcpy(bytes.data() + header.chunkOffset, mesh.chunks.data(), mesh.chunks.size_bytes());
+    std::memcpy(bytes.data() + header.meshletOffset, mesh.meshlets.data(), mesh.meshlets.size_bytes());
+    std::memcpy(bytes.data() + header.lodOffset, mesh.lods.data(), mesh.lods.size_bytes());
+    writeFileAtomically(path, bytes);
+}
+
+// Pipeline cache data is opaque and only valid for the vendor/device/driver build (UUID) that produced it.
+bool isPipelineCacheCompatible(std::span<const unsigned char> data, const VkPhysicalDeviceProperties& properties)
+{
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    // headerSize covers the header only; a larger value from a truncated or corrupt file must not be trusted
+    return (header.headerSize >= sizeof(header))                                 //
+           && (header.headerSize <= data.size())                                 //
+           && (header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE)     //
+           && (header.vendorID == properties.vendorID)                           //
+           && (header.deviceID == properties.deviceID)                           //
+           && (std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+}
+
+// Texel block layout of the formats a texture cache can hold.
+struct TextureFormatInfo
+{
+    const char* name = nullptr;
+    uint32_t blockExtent = 0; // 1 for uncompressed formats, 4 for BCn
+    uint32_t blockBytes = 0;
+};
+
+TextureFormatInfo getTextureFormatInfo(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return {"RGBA8", 1, 4};
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        return {"BC1", 4, 8};
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return {"BC3", 4, 16};
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return {"BC7", 4, 16};
+    default:
+        return {};
+    }
+}
+
+uint64_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    const TextureFormatInfo info = getTextureFormatInfo(format);
+    const uint64_t blocksX = (width + info.blockExtent - 1) / info.blockExtent;
+    const uint64_t blocksY = (height + info.blockExtent - 1) / info.blockExtent;
+    return blocksX * blocksY * info.blockBytes;
+}
+
+// KTX2-like texture container: header with a level index, then every mip level stored as it is
+// laid out for vkCmdCopyBufferToImage (tightly packed rows, level 0 first).
+// Bump kVersion whenever the baking (filtering, format) changes.
+struct TextureCacheHeader
+{
+    static constexpr uint32_t kMagic = 0x58544B56; // "VKTX"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kMaxLevels = 16;
+    static constexpr uint64_t kLevelAlignment = 16; // multiple of any texel/block size
+
+    struct Level
+    {
+        uint64_t offset = 0; // from the start of the file
+        uint64_t size = 0;
+    };
+
+    uint32_t magic = kMagic;
+    uint32_t version = kVersion;
+    uint64_t sourceHash = 0; // hashBytes() of the source image file
+    uint32_t format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levelCount = 0;
+    Level levels[kMaxLevels]{};
+
+    uint32_t levelWidth(uint32_t level) const
+    {
+        return std::max(1u, width >> level);
+    }
+
+    uint32_t levelHeight(uint32_t level) const
+    {
+        return std::max(1u, height >> level);
+    }
+
+    // Fills levels[] for the current format/extent/levelCount; returns the total file size.
+    uint64_t layoutLevels()
+    {
+        uint64_t offset = alignUp(sizeof(TextureCacheHeader), kLevelAlignment);
+        for (uint32_t i = 0; i < levelCount; ++i)
+        {
+            levels[i].offset = offset;
+            levels[i].size = textureLevelSize(VkFormat(format), levelWidth(i), levelHeight(i));
+            offset = alignUp(offset + levels[i].size, kLevelAlignment);
+        }
+        return offset;
+    }
+
+    // All levels, as uploaded to the GPU.
+    uint64_t payloadSize() const
+    {
+        return levels[levelCount - 1].offset + levels[levelCount - 1].size - levels[0].offset;
+    }
+};
+
+bool viewTextureCache(std::span<const unsigned char> file, uint64_t sourceHash, TextureCacheHeader& header)
+{
+    if (file.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if ((header.magic != TextureCacheHeader::kMagic)                                              //
+        || (header.version != TextureCacheHeader::kVersion)                                       //
+        || (header.sourceHash != sourceHash)                                                      //
+        || (header.width == 0) || (header.height == 0)                                            //
+        || (header.levelCount == 0)                                                               //
+        || (header.levelCount > TextureCacheHeader::kMaxLevels)                                   //
+        || (header.levelCount > uint32_t(std::bit_width(std::max(header.width, header.height)))) //
+        || (getTextureFormatInfo(VkFormat(header.format)).name == nullptr))
+    {
+        return false;
+    }
+    // Levels follow the header in order without overlapping, so payloadSize() cannot underflow; ranges are
+    // checked against the file size without an addition that could wrap.
+    uint64_t levelsEnd = alignUp(sizeof(TextureCacheHeader), TextureCacheHeader::kLevelAlignment);
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        const TextureCacheHeader::Level& level = header.levels[i];
+        if (((level.offset % TextureCacheHeader::kLevelAlignment) != 0) //
+            || (level.size != textureLevelSize(VkFormat(header.format), header.levelWidth(i), header.levelHeight(i))) //
+            || (level.offset < levelsEnd)                                //
+            || (level.size > file.size()) || (level.offset > (file.size() - level.size)))
+        {
+            return false;
+        }
+        levelsEnd = level.offset + level.size;
+    }
+    return true;
+}
+
+float srgbToLinear(unsigned char value)
+{
+    static const std::array<float, 256> kTable = []() {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; ++i)
+        {
+            const float c = float(i) / 255.0f;
+            table[i] = (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    return kTable[value];
+}
+
+unsigned char linearToSrgb(float value)
+{
+    value = std::clamp(value, 0.0f, 1.0f);
+    const float c = (value <= 0.0031308f) ? (value * 12.92f) : ((1.055f * std::pow(value, 1.0f / 2.4f)) - 0.055f);
+    return static_cast<unsigned char>((c * 255.0f) + 0.5f);
+}
+
+// 2x2 box filter in linear space (alpha is linear already); odd sizes clamp to the last row/column.
+void downsampleRgba8Srgb(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight, unsigned char* dst)
+{
+    const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+    const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+        const uint32_t y1 = std::min((y * 2) + 1, srcHeight - 1);
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+            const uint32_t x1 = std::min((x * 2) + 1, srcWidth - 1);
+            const unsigned char* texels[] = {
+                src + (std::size_t(y0) * srcWidth + x0) * 4, //
+                src + (std::size_t(y0) * srcWidth + x1) * 4, //
+                src + (std::size_t(y1) * srcWidth + x0) * 4, //
+                src + (std::size_t(y1) * srcWidth + x1) * 4, //
+            };
+            unsigned char* out = dst + (std::size_t(y) * dstWidth + x) * 4;
+            for (int c = 0; c < 3; ++c)
+            {
+                float sum = 0.0f;
+                for (const unsigned char* texel : texels)
+                {
+                    sum += srgbToLinear(texel[c]);
+                }
+                out[c] = linearToSrgb(sum * 0.25f);
+            }
+            const unsigned alpha = unsigned(texels[0][3]) + texels[1][3] + texels[2][3] + texels[3][3];
+            out[3] = static_cast<unsigned char>((alpha + 2) / 4);
+        }
+    }
+}
+
+// 4x4 texel block in structure-of-arrays form (r, g, b, a rows), values in [0, 255].
+struct TexelBlock
+{
+    alignas(16) float channels[4][16];
+};
+
+void loadTexelBlock(
+    const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, TexelBlock& block)
+{
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        // Partial blocks at the right/bottom edge repeat the last texel.
+        const uint32_t x = std::min((blockX * 4) + (i % 4), width - 1);
+        const uint32_t y = std::min((blockY * 4) + (i / 4), height - 1);
+        const unsigned char* texel = rgba + (std::size_t(y) * width + x) * 4;
+        for (int c = 0; c < 4; ++c)
+        {
+            block.channels[c][i] = float(texel[c]);
+        }
+    }
+}
+
+// Projects every texel onto the segment from -> to and snaps it to one of (steps + 1) evenly spaced
+// palette entries: 0 is `from`, steps is `to`. This is the hot loop of all the encoders below.
+void fitTexelBlock(const TexelBlock& block, const std::array<float, 4>& from, const std::array<float, 4>& to,
+    uint32_t steps, uint8_t indices[16])
+{
+    std::array<float, 4> axis{};
+    float lengthSq = 0.0f;
+    for (int c = 0; c < 4; ++c)
+    {
+        axis[c] = to[c] - from[c];
+        lengthSq += axis[c] * axis[c];
+    }
+    const float scale = (lengthSq > 0.0f) ? (float(steps) / lengthSq) : 0.0f;
+#if (KK_HAS_SSE2)
+    const __m128 maxStep = _mm_set1_ps(float(steps));
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 t = _mm_setzero_ps();
+        for (int c = 0; c < 4; ++c)
+        {
+            const __m128 delta = _mm_sub_ps(_mm_load_ps(&block.channels[c][i]), _mm_set1_ps(from[c]));
+            t = _mm_add_ps(t, _mm_mul_ps(delta, _mm_set1_ps(axis[c] * scale)));
+        }
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), maxStep);
+        alignas(16) int32_t rounded[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(rounded), _mm_cvttps_epi32(_mm_add_ps(t, _mm_set1_ps(0.5f))));
+        for (int k = 0; k < 4; ++k)
+        {
+            indices[i + k] = uint8_t(rounded[k]);
+        }
+    }
+#else
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            t += (block.channels[c][i] - from[c]) * axis[c] * scale;
+        }
+        indices[i] = uint8_t(std::clamp(t, 0.0f, float(steps)) + 0.5f);
+    }
+#endif
+}
+
+// Endpoints along the principal axis of the block's first channelCount channels
+// (covariance + power iteration); remaining channels are set to 255.
+void findPrincipalEndpoints(
+    const TexelBlock& block, int channelCount, std::array<float, 4>& low, std::array<float, 4>& high)
+{
+    std::array<float, 4> mean{};
+    std::array<float, 4> minimum{255.0f, 255.0f, 255.0f, 255.0f};
+    std::array<float, 4> maximum{};
+    for (int c = 0; c < channelCount; ++c)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            mean[c] += block.channels[c][i];
+            minimum[c] = std::min(minimum[c], block.channels[c][i]);
+            maximum[c] = std::max(maximum[c], block.channels[c][i]);
+        }
+        mean[c] /= 16.0f;
+    }
+    float covariance[4][4]{};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int a = 0; a < channelCount; ++a)
+        {
+            for (int b = a; b < channelCount; ++b)
+            {
+                covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+            }
+        }
+    }
+    // Start from the bounding box diagonal; a few iterations are plenty for a 4x4 block.
+    std::array<float, 4> axis{};
+    for (int c = 0; c < channelCount; ++c)
+    {
+        axis[c] = maximum[c] - minimum[c];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        std::array<float, 4> next{};
+        float length = 0.0f;
+        for (int a = 0; a < channelCount; ++a)
+        {
+            for (int b = 0; b < channelCount; ++b)
+            {
+                next[a] += ((a <= b) ? covariance[a][b] : covariance[b][a]) * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length == 0.0f)
+        {
+            break;
+        }
+        for (int c = 0; c < channelCount; ++c)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+    float lengthSq = 0.0f;
+    for (int c = 0; c < channelCount; ++c)
+    {
+        lengthSq += axis[c] * axis[c];
+    }
+    float tMin = 0.0f;
+    float tMax = 0.0f;
+    if (lengthSq > 0.0f)
+    {
+        tMin = std::numeric_limits<float>::max();
+        tMax = -std::numeric_limits<float>::max();
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channelCount; ++c)
+            {
+                t += (block.channels[c][i] - mean[c]) * axis[c];
+            }
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+        tMin /= lengthSq;
+        tMax /= lengthSq;
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+        low[c] = (c < channelCount) ? std::clamp(mean[c] + (axis[c] * tMin), 0.0f, 255.0f) : 255.0f;
+        high[c] = (c < channelCount) ? std::clamp(mean[c] + (axis[c] * tMax), 0.0f, 255.0f) : 255.0f;
+    }
+}
+
+uint16_t packRgb565(const std::array<float, 4>& color)
+{
+    const uint32_t r = uint32_t((color[0] * 31.0f / 255.0f) + 0.5f);
+    const uint32_t g = uint32_t((color[1] * 63.0f / 255.0f) + 0.5f);
+    const uint32_t b = uint32_t((color[2] * 31.0f / 255.0f) + 0.5f);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+std::array<uint32_t, 4> unpackRgb565(uint16_t color)
+{
+    const uint32_t r = (color >> 11) & 31;
+    const uint32_t g = (color >> 5) & 63;
+    const uint32_t b = color & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255};
+}
+
+// BC1 color block, always in the 4-color mode (color0 > color1).
+void encodeBc1Block(const TexelBlock& block, unsigned char* out)
+{
+    std::array<float, 4> low{};
+    std::array<float, 4> high{};
+    findPrincipalEndpoints(block, 3, low, high);
+    uint16_t color0 = packRgb565(high);
+    uint16_t color1 = packRgb565(low);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indexBits = 0;
+    if (color0 != color1)
+    {
+        const std::array<uint32_t, 4> unpacked0 = unpackRgb565(color0);
+        const std::array<uint32_t, 4> unpacked1 = unpackRgb565(color1);
+        const std::array<float, 4> endpoint0{float(unpacked0[0]), float(unpacked0[1]), float(unpacked0[2]), 0.0f};
+        const std::array<float, 4> endpoint1{float(unpacked1[0]), float(unpacked1[1]), float(unpacked1[2]), 0.0f};
+        uint8_t steps[16];
+        fitTexelBlock(block, endpoint0, endpoint1, 3, steps);
+        // Palette codes ordered from color0 to color1.
+        static constexpr uint32_t kCodes[4] = {0, 2, 3, 1};
+        for (int i = 0; i < 16; ++i)
+        {
+            indexBits |= kCodes[steps[i]] << (2 * i);
+        }
+    }
+    std::memcpy(out + 0, &color0, sizeof(color0));
+    std::memcpy(out + 2, &color1, sizeof(color1));
+    std::memcpy(out + 4, &indexBits, sizeof(indexBits));
+}
+
+// BC3 alpha block, always in the 8-alpha mode (alpha0 > alpha1).
+void encodeBc3AlphaBlock(const TexelBlock& block, unsigned char* out)
+{
+    const float* alpha = block.channels[3];
+    const float alpha0 = *std::max_element(alpha, alpha + 16);
+    const float alpha1 = *std::min_element(alpha, alpha + 16);
+    uint64_t indexBits = 0;
+    if (alpha0 != alpha1)
+    {
+        uint8_t steps[16];
+        fitTexelBlock(block, {0.0f, 0.0f, 0.0f, alpha0}, {0.0f, 0.0f, 0.0f, alpha1}, 7, steps);
+        // Palette codes ordered from alpha0 to alpha1.
+        static constexpr uint64_t kCodes[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+        for (int i = 0; i < 16; ++i)
+        {
+            indexBits |= kCodes[steps[i]] << (3 * i);
+        }
+    }
+    out[0] = uint8_t(alpha0);
+    out[1] = uint8_t(alpha1);
+    std::memcpy(out + 2, &indexBits, 6);
+}
+
+void encodeBc3Block(const TexelBlock& block, unsigned char* out)
+{
+    encodeBc3AlphaBlock(block, out);
+    encodeBc1Block(block, out + 8);
+}
+
+// Little-endian bit stream over a 16-byte block, as BC7 lays out its fields.
+struct BlockBitWriter
+{
+    uint64_t words[2]{};
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; ++i, ++position)
+        {
+            words[position / 64] |= uint64_t((value >> i) & 1) << (position % 64);
+        }
+    }
+};
+
+struct BlockBitReader
+{
+    uint64_t words[2]{};
+    uint32_t position = 0;
+
+    uint32_t read(uint32_t bitCount)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bitCount; ++i, ++position)
+        {
+            value |= uint32_t((words[position / 64] >> (position % 64)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+const uint32_t kBc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// BC7 mode 6 endpoint: 7 bits per RGBA channel plus one p-bit shared as the LSB of all channels.
+struct Bc7Mode6Endpoint
+{
+    std::array<uint32_t, 4> values{}; // 7-bit
+    uint32_t pBit = 0;
+
+    std::array<float, 4> unpack() const
+    {
+        return {float((values[0] << 1) | pBit), float((values[1] << 1) | pBit), float((values[2] << 1) | pBit),
+            float((values[3] << 1) | pBit)};
+    }
+};
+
+Bc7Mode6Endpoint quantizeBc7Mode6Endpoint(const std::array<float, 4>& color)
+{
+    Bc7Mode6Endpoint best{};
+    float bestError = std::numeric_limits<float>::max();
+    for (uint32_t pBit = 0; pBit < 2; ++pBit)
+    {
+        Bc7Mode6Endpoint candidate{};
+        candidate.pBit = pBit;
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            candidate.values[c] = uint32_t(std::clamp((color[c] - float(pBit)) / 2.0f + 0.5f, 0.0f, 127.0f));
+            const float delta = float((candidate.values[c] << 1) | pBit) - color[c];
+            error += delta * delta;
+        }
+        if (error < bestError)
+        {
+            best = candidate;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+// BC7 mode 6 only: one subset, RGBA endpoints, 4-bit indices. Good quality for both
+// opaque and alpha textures with a fraction of the search a full BC7 encoder does.
+void encodeBc7Block(const TexelBlock& block, unsigned char* out)
+{
+    std::array<float, 4> low{};
+    std::array<float, 4> high{};
+    findPrincipalEndpoints(block, 4, low, high);
+    Bc7Mode6Endpoint endpoints[2] = {quantizeBc7Mode6Endpoint(low), quantizeBc7Mode6Endpoint(high)};
+
+    uint8_t indices[16];
+    fitTexelBlock(block, endpoints[0].unpack(), endpoints[1].unpack(), 15, indices);
+    // The anchor index is stored without its MSB: flip the endpoints if it is set.
+    if (indices[0] & 8)
+    {
+        std::swap(endpoints[0], endpoints[1]);
+        for (uint8_t& index : indices)
+        {
+            index = uint8_t(15 - index);
+        }
+    }
+
+    BlockBitWriter bits;
+    bits.write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c)
+    {
+        bits.write(endpoints[0].values[c], 7);
+        bits.write(endpoints[1].values[c], 7);
+    }
+    bits.write(endpoints[0].pBit, 1);
+    bits.write(endpoints[1].pBit, 1);
+    bits.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+    {
+        bits.write(indices[i], 4);
+    }
+    std::memcpy(out, bits.words, 16);
+}
+
+void decodeBc1ColorBlock(const unsigned char* in, bool alwaysFourColors, unsigned char texels[16][4])
+{
+    uint16_t color0 = 0;
+    uint16_t color1 = 0;
+    uint32_t indexBits = 0;
+    std::memcpy(&color0, in + 0, sizeof(color0));
+    std::memcpy(&color1, in + 2, sizeof(color1));
+    std::memcpy(&indexBits, in + 4, sizeof(indexBits));
+
+    std::array<uint32_t, 4> palette[4] = {unpackRgb565(color0), unpackRgb565(color1)};
+    for (int c = 0; c < 3; ++c)
+    {
+        if (alwaysFourColors || (color0 > color1))
+        {
+            palette[2][c] = ((2 * palette[0][c]) + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + (2 * palette[1][c]) + 1) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        const std::array<uint32_t, 4>& color = palette[(indexBits >> (2 * i)) & 3];
+        for (int c = 0; c < 3; ++c)
+        {
+            texels[i][c] = uint8_t(color[c]);
+        }
+        texels[i][3] = 255;
+    }
+}
+
+void decodeBc3AlphaBlock(const unsigned char* in, unsigned char texels[16][4])
+{
+    uint32_t palette[8] = {in[0], in[1]};
+    if (palette[0] > palette[1])
+    {
+        for (uint32_t i = 2; i < 8; ++i)
+        {
+            palette[i] = (((8 - i) * palette[0]) + ((i - 1) * palette[1]) + 3) / 7;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 2; i < 6; ++i)
+        {
+            palette[i] = (((6 - i) * palette[0]) + ((i - 1) * palette[1]) + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indexBits = 0;
+    std::memcpy(&indexBits, in + 2, 6);
+    for (int i = 0; i < 16; ++i)
+    {
+        texels[i][3] = uint8_t(palette[(indexBits >> (3 * i)) & 7]);
+    }
+}
+
+// Only mode 6 blocks, the ones encodeBc7Block() produces, are supported.
+bool decodeBc7Block(const unsigned char* in, unsigned char texels[16][4])
+{
+    BlockBitReader bits;
+    std::memcpy(bits.words, in, 16);
+    if (bits.read(7) != (1u << 6))
+    {
+        return false;
+    }
+    Bc7Mode6Endpoint endpoints[2];
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0].values[c] = bits.read(7);
+        endpoints[1].values[c] = bits.read(7);
+    }
+    endpoints[0].pBit = bits.read(1);
+    endpoints[1].pBit = bits.read(1);
+    const std::array<float, 4> color0 = endpoints[0].unpack();
+    const std::array<float, 4> color1 = endpoints[1].unpack();
+    for (int i = 0; i < 16; ++i)
+    {
+        const uint32_t weight = kBc7Weights4[bits.read((i == 0) ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+        {
+            texels[i][c] = uint8_t((((64 - weight) * uint32_t(color0[c])) + (weight * uint32_t(color1[c])) + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+// Encodes one RGBA8 level into `format`; block rows are spread over all cores.
+void encodeTextureLevel(VkFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, unsigned char* out)
+{
+    if (format == VK_FORMAT_R8G8B8A8_SRGB)
+    {
+        std::memcpy(out, rgba, std::size_t(width) * height * 4);
+        return;
+    }
+    const TextureFormatInfo info = getTextureFormatInfo(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const unsigned threadCount = std::clamp(blocksY / 16, 1u, std::max(1u, std::thread::hardware_concurrency()));
+    runParallel(threadCount, [&](unsigned thread) {
+        TexelBlock block{};
+        for (uint32_t blockY = thread; blockY < blocksY; blockY += threadCount)
+        {
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+            {
+                loadTexelBlock(rgba, width, height, blockX, blockY, block);
+                unsigned char* encoded = out + (std::size_t(blockY) * blocksX + blockX) * info.blockBytes;
+                switch (format)
+                {
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    encodeBc1Block(block, encoded);
+                    break;
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                    encodeBc3Block(block, encoded);
+                    break;
+                case VK_FORMAT_BC7_SRGB_BLOCK:
+                    encodeBc7Block(block, encoded);
+                    break;
+                default:
+                    KK_VERIFY(false);
+                }
+            }
+        }
+    });
+}
+
+// Decodes one level of `format` back into RGBA8.
+bool decodeTextureLevel(VkFormat format, const unsigned char* in, uint32_t width, uint32_t height, unsigned char* rgba)
+{
+    if (format == VK_FORMAT_R8G8B8A8_SRGB)
+    {
+        std::memcpy(rgba, in, std::size_t(width) * height * 4);
+        return true;
+    }
+    const TextureFormatInfo info = getTextureFormatInfo(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+        {
+            const unsigned char* encoded = in + (std::size_t(blockY) * blocksX + blockX) * info.blockBytes;
+            unsigned char texels[16][4]{};
+            switch (format)
+            {
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                decodeBc1ColorBlock(encoded, false, texels);
+                break;
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                decodeBc1ColorBlock(encoded + 8, true, texels);
+                decodeBc3AlphaBlock(encoded, texels);
+                break;
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                if (!decodeBc7Block(encoded, texels))
+                {
+                    return false;
+                }
+                break;
+            default:
+                return false;
+            }
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                const uint32_t x = (blockX * 4) + (i % 4);
+                const uint32_t y = (blockY * 4) + (i / 4);
+                if ((x < width) && (y < height))
+                {
+                    std::memcpy(rgba + (std::size_t(y) * width + x) * 4, texels[i], 4);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Builds the complete texture cache file (header + full mip chain) from RGBA8 sRGB pixels.
+// The mip chain is filtered in RGBA8 and every level is then encoded into `format`.
+std::vector<unsigned char> bakeTextureCache(
+    const unsigned char* rgba, uint32_t width, uint32_t height, uint64_t sourceHash, VkFormat format)
+{
+    TextureCacheHeader header{};
+    header.sourceHash = sourceHash;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.levelCount = uint32_t(std::floor(std::log2(std::max(width, height)))) + 1;
+    KK_VERIFY(header.levelCount <= TextureCacheHeader::kMaxLevels);
+    KK_VERIFY(getTextureFormatInfo(format).name);
+
+    std::vector<unsigned char> file(header.layoutLevels());
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::vector<unsigned char> level(rgba, rgba + std::size_t(width) * height * 4);
+    std::vector<unsigned char> nextLevel;
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        if (i > 0)
+        {
+            nextLevel.resize(std::size_t(header.levelWidth(i)) * header.levelHeight(i) * 4);
+            downsampleRgba8Srgb(level.data(), header.levelWidth(i - 1), header.levelHeight(i - 1), nextLevel.data());
+            std::swap(level, nextLevel);
+        }
+        encodeTextureLevel(
+            format, level.data(), header.levelWidth(i), header.levelHeight(i), file.data() + header.levels[i].offset);
+    }
+    return file;
+}
+
+// CPU fallback for devices that can't sample the cached format: the same mip chain as plain RGBA8.
+std::vector<unsigned char> decodeTextureCache(std::span<const unsigned char> file, const TextureCacheHeader& header)
+{
+    TextureCacheHeader decoded = header;
+    decoded.format = VK_FORMAT_R8G8B8A8_SRGB;
+    std::vector<unsigned char> decodedFile(decoded.layoutLevels());
+    std::memcpy(decodedFile.data(), &decoded, sizeof(decoded));
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        KK_VERIFY(decodeTextureLevel(VkFormat(header.format), file.data() + header.levels[i].offset,
+            header.levelWidth(i), header.levelHeight(i), decodedFile.data() + decoded.levels[i].offset));
+    }
+    return decodedFile;
+}
+
+// Texture cache contents ready for upload: mapped from disk, freshly baked or decoded on the CPU.
+struct TextureData
+{
+    TextureCacheHeader header{};
+    std::span<const unsigned char> file; // points into cacheFile or ownedFile
+    MappedFile cacheFile;
+    std::vector<unsigned char> ownedFile;
+};
+
+struct StagingRegion
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    unsigned char* data = nullptr; // persistently mapped
+    VkDeviceSize size = 0;
+};
+
+// Ring allocator over one persistently mapped staging buffer. Positions grow monotonically
+// (offset in the buffer = position % capacity); everything allocated before a mark() is
+// given back with release(mark) once the submission that reads it has finished.
+class StagingRing
+{
+public:
+    void init(VkBuffer buffer, unsigned char* mapped, VkDeviceSize capacity)
+    {
+        KK_VERIFY(std::has_single_bit(capacity));
+        buffer_ = buffer;
+        mapped_ = mapped;
+        capacity_ = capacity;
+        head_ = 0;
+        tail_ = 0;
+    }
+
+    // False when there is no room until older submissions retire.
+    // alignment must be a power of two not bigger than the capacity.
+    bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, StagingRegion& region)
+    {
+        KK_VERIFY(size <= capacity_);
+        if (head_ == tail_)
+        {
+            // Empty: restart at the beginning of the buffer so large regions fit without wrapping.
+            head_ = alignUp(head_, capacity_);
+            tail_ = head_;
+        }
+        uint64_t position = alignUp(head_, alignment);
+        if (((position % capacity_) + size) > capacity_)
+        {
+            // Never split a region across the end of the buffer: skip to the start.
+            position = alignUp(head_, capacity_);
+        }
+        if ((position + size - tail_) > capacity_)
+        {
+            return false;
+        }
+        const VkDeviceSize offset = position % capacity_;
+        region = {buffer_, offset, mapped_ + offset, size};
+        head_ = position + size;
+        return true;
+    }
+
+    uint64_t mark() const
+    {
+        return head_;
+    }
+
+    void release(uint64_t mark)
+    {
+        KK_VERIFY(mark <= head_);
+        tail_ = std::max(tail_, mark);
+    }
+
+    VkDeviceSize capacity() const
+    {
+        return capacity_;
+    }
+
+private:
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    unsigned char* mapped_ = nullptr;
+    VkDeviceSize capacity_ = 0;
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+};
+
+struct UniformRegion
+{
+    uint32_t offset = 0; // dynamic offset of a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding
+    unsigned char* data = nullptr;
+};
+
+// Linear allocator over one persistently mapped uniform buffer with a slice per frame in flight.
+// beginFrame() rewinds the frame's slice once its fence has been waited on; every allocation is then
+// bound with a dynamic offset into the same buffer, so no buffer or descriptor set exists per frame or draw.
+class UniformRing
+{
+public:
+    // alignment: minUniformBufferOffsetAlignment (a power of two).
+    void init(VkBuffer buffer, unsigned char* mapped, VkDeviceSize frameSize, VkDeviceSize alignment)
+    {
+        KK_VERIFY(std::has_single_bit(alignment) && ((frameSize % alignment) == 0));
+        buffer_ = buffer;
+        mapped_ = mapped;
+        frameSize_ = frameSize;
+        alignment_ = alignment;
+        begin_ = 0;
+        head_ = 0;
+    }
+
+    void beginFrame(uint32_t frame)
+    {
+        begin_ = frame * frameSize_;
+        head_ = begin_;
+    }
+
+    UniformRegion allocate(VkDeviceSize size)
+    {
+        const uint64_t position = alignUp(head_, alignment_);
+        KK_VERIFY((position + size) <= (begin_ + frameSize_));
+        head_ = position + size;
+        return {uint32_t(position), mapped_ + position};
+    }
+
+    VkBuffer buffer() const
+    {
+        return buffer_;
+    }
+
+private:
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    unsigned char* mapped_ = nullptr;
+    VkDeviceSize frameSize_ = 0;
+    VkDeviceSize alignment_ = 1;
+    uint64_t begin_ = 0;
+    uint64_t head_ = 0;
+};
+
+// Two-level segregated fit (TLSF) allocator over the byte range [0, size).
+// Chunks are linked in address order so a freed chunk coalesces with free neighbours; free
+// chunks are bucketed by size class (power-of-two first level, split into kSecondLevelCount
+// linear steps) with a bitmap per level, so allocate() and free() never scan lists.
+class TlsfAllocator
+{
+public:
+    static constexpr uint32_t kNoChunk = std::numeric_limits<uint32_t>::max();
+    // Every offset and size is a multiple of this.
+    static constexpr VkDeviceSize kMinAlignment = 256;
+
+    void init(VkDeviceSize size)
+    {
+        KK_VERIFY(size >= kMinAlignment);
+        chunks_.clear();
+        unusedChunks_.clear();
+        firstLevelMap_ = 0;
+        std::ranges::fill(secondLevelMaps_, 0u);
+        std::ranges::fill(freeHeads_, kNoChunk);
+        size_ = size - (size % kMinAlignment);
+        used_ = 0;
+        insertFree(newChunk(0, size_, kNoChunk, kNoChunk));
+    }
+
+    // Returns the chunk handle for free(), or kNoChunk if nothing fits.
+    // alignment must be a power of two.
+    uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+    {
+        size = alignUp(std::max<VkDeviceSize>(size, 1), kMinAlignment);
+        alignment = std::max(alignment, kMinAlignment);
+        // Worst-case padding is included in the search so any chunk found can be aligned in place.
+        const VkDeviceSize searchSize = size + (alignment - kMinAlignment);
+        uint32_t index = findFree(searchSize);
+        if (index == kNoChunk)
+        {
+            index = findInExactClass(searchSize, size, alignment);
+        }
+        if (index == kNoChunk)
+        {
+            return kNoChunk;
+        }
+        removeFree(index);
+
+        const VkDeviceSize padding = alignUp(chunks_[index].offset, alignment) - chunks_[index].offset;
+        if (padding > 0)
+        {
+            // The chunk in front is in use (free neighbours are always merged), so the padding
+            // becomes a free chunk of its own.
+            const uint32_t front = newChunk(chunks_[index].offset, padding, chunks_[index].prev, index);
+            if (chunks_[front].prev != kNoChunk)
+            {
+                chunks_[chunks_[front].prev].next = front;
+            }
+            chunks_[index].prev = front;
+            chunks_[index].offset += padding;
+            chunks_[index].size -= padding;
+            insertFree(front);
+        }
+        if (chunks_[index].size > size)
+        {
+            const uint32_t back =
+                newChunk(chunks_[index].offset + size, chunks_[index].size - size, index, chunks_[index].next);
+            if (chunks_[back].next != kNoChunk)
+            {
+                chunks_[chunks_[back].next].prev = back;
+            }
+            chunks_[index].next = back;
+            chunks_[index].size = size;
+            insertFree(back);
+        }
+        used_ += size;
+        offset = chunks_[index].offset;
+        return index;
+    }
+
+    void free(uint32_t index)
+    {
+        KK_VERIFY(index < chunks_.size());
+        KK_VERIFY(!chunks_[index].free);
+        used_ -= chunks_[index].size;
+        const uint32_t next = chunks_[index].next;
+        if ((next != kNoChunk) && chunks_[next].free)
+        {
+            removeFree(next);
+            mergeWithNext(index);
+        }
+        const uint32_t prev = chunks_[index].prev;
+        if ((prev != kNoChunk) && chunks_[prev].free)
+        {
+            removeFree(prev);
+            mergeWithNext(prev);
+            index = prev;
+        }
+        insertFree(index);
+    }
+
+    VkDeviceSize size() const
+    {
+        return size_;
+    }
+
+    VkDeviceSize used() const
+    {
+        return used_;
+    }
+
+    VkDeviceSize largestFree() const
+    {
+        if (firstLevelMap_ == 0)
+        {
+            return 0;
+        }
+        const uint32_t firstLevel = 63 - uint32_t(std::countl_zero(firstLevelMap_));
+        const uint32_t secondLevel = 31 - uint32_t(std::countl_zero(secondLevelMaps_[firstLevel]));
+        VkDeviceSize largest = 0;
+        for (uint32_t index = freeHeads_[(firstLevel * kSecondLevelCount) + secondLevel]; index != kNoChunk;
+             index = chunks_[index].nextFree)
+        {
+            largest = std::max(largest, chunks_[index].size);
+        }
+        return largest;
+    }
+
+private:
+    static constexpr uint32_t kSecondLevelLog2 = 4;
+    static constexpr uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+    static constexpr uint32_t kFirstLevelCount = 64;
+
+    struct Chunk
+    {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t prev = kNoChunk; // neighbours in address order
+        uint32_t next = kNoChunk;
+        uint32_t prevFree = kNoChunk; // links in the size-class free list
+        uint32_t nextFree = kNoChunk;
+        bool free = false;
+    };
+
+    // Class (0, n) holds exactly n units; class (f > 0, s) holds [16 + s, 17 + s) << (f - 1) units.
+    static void sizeClass(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel)
+    {
+        const uint64_t units = size / kMinAlignment;
+        if (units < kSecondLevelCount)
+        {
+            firstLevel = 0;
+            secondLevel = uint32_t(units);
+            return;
+        }
+        firstLevel = uint32_t(std::bit_width(units)) - kSecondLevelLog2;
+        secondLevel = uint32_t(units >> (firstLevel - 1)) - kSecondLevelCount;
+    }
+
+    uint32_t findFree(VkDeviceSize size) const
+    {
+        uint64_t units = (size + kMinAlignment - 1) / kMinAlignment;
+        if (units >= kSecondLevelCount)
+        {
+            // Round up to the next class boundary: every chunk in that class is big enough.
+            units += (uint64_t(1) << (std::bit_width(units) - kSecondLevelLog2 - 1)) - 1;
+        }
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        sizeClass(units * kMinAlignment, firstLevel, secondLevel);
+        if (firstLevel >= kFirstLevelCount)
+        {
+            return kNoChunk;
+        }
+        uint32_t secondLevelMap = secondLevelMaps_[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0)
+        {
+            const uint64_t firstLevelMap =
+                (firstLevel + 1 < kFirstLevelCount) ? (firstLevelMap_ & (~uint64_t(0) << (firstLevel + 1))) : 0;
+            if (firstLevelMap == 0)
+            {
+                return kNoChunk;
+            }
+            firstLevel = uint32_t(std::countr_zero(firstLevelMap));
+            secondLevelMap = secondLevelMaps_[firstLevel];
+        }
+        secondLevel = uint32_t(std::countr_zero(secondLevelMap));
+        return freeHeads_[(firstLevel * kSecondLevelCount) + secondLevel];
+    }
+
+    // findFree() skips the class `size` itself falls into since not every chunk there is big enough;
+    // this walks that one list so a request for (say) the whole remaining block still succeeds.
+    uint32_t findInExactClass(VkDeviceSize searchSize, VkDeviceSize size, VkDeviceSize alignment) const
+    {
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        sizeClass(searchSize, firstLevel, secondLevel);
+        if (firstLevel >= kFirstLevelCount)
+        {
+            return kNoChunk;
+        }
+        for (uint32_t index = freeHeads_[(firstLevel * kSecondLevelCount) + secondLevel]; index != kNoChunk;
+             index = chunks_[index].nextFree)
+        {
+            const Chunk& chunk = chunks_[index];
+            if ((alignUp(chunk.offset, alignment) - chunk.offset + size) <= chunk.size)
+            {
+                return index;
+            }
+        }
+        return kNoChunk;
+    }
+
+    void insertFree(uint32_t index)
+    {
+        uint32_t firstLevel = 0;
+        uint32_t secondLevel = 0;
+        sizeClass(chunks_[index].size, firstLevel, secondLevel);
+        uint32_t& head = freeHeads_[(firstLevel * kSecondLevelCount) + secondLevel];
+        chunks_[index].free = true;
+        chunks_[index].prevFree = kNoChunk;
+        chunks_[index].nextFree = head;
+        if (head != kNoChunk)
+        {
+            chunks_[head].prevFree = index;
+        }
+        head = index;
+        firstLevelMap_ |= uint64_t(1) << firstLevel;
+        secondLevelMaps_[firstLevel] |= 1u << secondLevel;
+    }
+
+    void removeFree(uint32_t index)
+    {
+        Chunk& chunk = chunks_[index];
+        KK_VERIFY(chunk.free);
+        if (chunk.prevFree != kNoChunk)
+        {
+            chunks_[chunk.prevFree].nextFree = chunk.nextFree;
+        }
+        else
+        {
+            uint32_t firstLevel = 0;
+            uint32_t secondLevel = 0;
+            sizeClass(chunk.size, firstLevel, secondLevel);
+            uint32_t& head = freeHeads_[(firstLevel * kSecondLevelCount) + secondLevel];
+            head = chunk.nextFree;
+            if (head == kNoChunk)
+            {
+                secondLevelMaps_[firstLevel] &= ~(1u << secondLevel);
+                if (secondLevelMaps_[firstLevel] == 0)
+                {
+                    firstLevelMap_ &= ~(uint64_t(1) << firstLevel);
+                }
+            }
+        }
+        if (chunk.nextFree != kNoChunk)
+        {
+            chunks_[chunk.nextFree].prevFree = chunk.prevFree;
+        }
+        chunk.free = false;
+        chunk.prevFree = kNoChunk;
+        chunk.nextFree = kNoChunk;
+    }
+
+    // Absorbs the (already unlinked from its free list) next chunk into `index`.
+    void mergeWithNext(uint32_t index)
+    {
+        const uint32_t next = chunks_[index].next;
+        chunks_[index].size += chunks_[next].size;
+        chunks_[index].next = chunks_[next].next;
+        if (chunks_[index].next != kNoChunk)
+        {
+            chunks_[chunks_[index].next].prev = index;
+        }
+        chunks_[next] = Chunk{};
+        unusedChunks_.push_back(next);
+    }
+
+    uint32_t newChunk(VkDeviceSize offset, VkDeviceSize size, uint32_t prev, uint32_t next)
+    {
+        uint32_t index = 0;
+        if (!unusedChunks_.empty())
+        {
+            index = unusedChunks_.back();
+            unusedChunks_.pop_back();
+        }
+        else
+        {
+            index = uint32_t(chunks_.size());
+            chunks_.emplace_back();
+        }
+        chunks_[index] = Chunk{offset, size, prev, next};
+        return index;
+    }
+
+private:
+    std::vector<Chunk> chunks_;
+    std::vector<uint32_t> unusedChunks_;
+    uint64_t firstLevelMap_ = 0;
+    std::array<uint32_t, kFirstLevelCount> secondLevelMaps_{};
+    std::array<uint32_t, kFirstLevelCount * kSecondLevelCount> freeHeads_{};
+    VkDeviceSize size_ = 0;
+    VkDeviceSize used_ = 0;
+};
+
+struct DeviceAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    unsigned char* mapped = nullptr; // points at `offset`; host-visible memory only
+    uint32_t memoryType = 0;
+    uint32_t block = 0; // DeviceMemoryAllocator::kDedicated for a standalone vkAllocateMemory
+    uint32_t chunk = 0;
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks (one TLSF allocator each),
+// so the number of vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+// A block holds either linear resources (buffers, LINEAR images) or optimal-tiling images but
+// never both, which keeps them bufferImageGranularity apart without per-neighbour checks.
+// Host-visible blocks stay mapped for their lifetime. Render targets and anything bigger than
+// half a block get a dedicated allocation instead.
+class DeviceMemoryAllocator
+{
+public:
+    static constexpr uint32_t kDedicated = std::numeric_limits<uint32_t>::max();
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+    {
+        device_ = device;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties_);
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity_ = properties.limits.bufferImageGranularity;
+        maxAllocationCount_ = properties.limits.maxMemoryAllocationCount;
+        blockSize_ = blockSize;
+        dedicatedCount_.assign(memoryProperties_.memoryHeapCount, 0);
+        dedicatedBytes_.assign(memoryProperties_.memoryHeapCount, 0);
+    }
+
+    // `linear`: buffer or LINEAR-tiling image. `dedicated`: the resource gets its own VkDeviceMemory.
+    DeviceAllocation allocate(
+        const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, bool dedicated)
+    {
+        const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+        const VkDeviceSize blockSize = blockSizeFor(memoryType);
+        if (dedicated || (requirements.size > (blockSize / 2)))
+        {
+            return allocateDedicated(requirements.size, memoryType);
+        }
+
+        // Nothing to keep apart when the device has no granularity restriction.
+        const bool blockLinear = linear && (bufferImageGranularity_ > 1);
+        for (uint32_t i = 0; i < blocks_.size(); ++i)
+        {
+            Block& block = blocks_[i];
+            if ((block.memory == VK_NULL_HANDLE) || (block.memoryType != memoryType) || (block.linear != blockLinear))
+            {
+                continue;
+            }
+            VkDeviceSize offset = 0;
+            const uint32_t chunk = block.tlsf.allocate(requirements.size, requirements.alignment, offset);
+            if (chunk != TlsfAllocator::kNoChunk)
+            {
+                return makeAllocation(i, chunk, offset, requirements.size);
+            }
+        }
+
+        const uint32_t index = createBlock(memoryType, blockLinear, blockSize);
+        VkDeviceSize offset = 0;
+        const uint32_t chunk = blocks_[index].tlsf.allocate(requirements.size, requirements.alignment, offset);
+        KK_VERIFY(chunk != TlsfAllocator::kNoChunk);
+        return makeAllocation(index, chunk, offset, requirements.size);
+    }
+
+    void free(DeviceAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        if (allocation.block == kDedicated)
+        {
+            const uint32_t heap = heapOf(allocation.memoryType);
+            dedicatedCount_[heap] -= 1;
+            dedicatedBytes_[heap] -= allocation.size;
+            vkFreeMemory(device_, allocation.memory, nullptr);
+            allocationCount_ -= 1;
+        }
+        else
+        {
+            Block& block = blocks_[allocation.block];
+            block.tlsf.free(allocation.chunk);
+            block.allocationCount -= 1;
+            // Keep one empty block per kind around so a free/allocate pattern does not thrash.
+            if ((block.allocationCount == 0) && hasOtherEmptyBlock(allocation.block))
+            {
+                destroyBlock(allocation.block);
+            }
+        }
+        allocation = {};
+    }
+
+    void destroy()
+    {
+        for (uint32_t i = 0; i < blocks_.size(); ++i)
+        {
+            if (blocks_[i].memory != VK_NULL_HANDLE)
+            {
+                KK_VERIFY(blocks_[i].allocationCount == 0);
+                destroyBlock(i);
+            }
+        }
+        blocks_.clear();
+        KK_VERIFY(allocationCount_ == 0);
+    }
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; ++i)
+        {
+            if ((typeFilter & (1 << i)) //
+                && (memoryProperties_.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+        KK_VERIFY(false);
+        return uint32_t(-1);
+    }
+
+    void printStats() const
+    {
+        constexpr double kMiB = 1024.0 * 1024.0;
+        for (uint32_t heap = 0; heap < memoryProperties_.memoryHeapCount; ++heap)
+        {
+            uint32_t blockCount = 0;
+            uint32_t subAllocationCount = 0;
+            VkDeviceSize blockBytes = 0;
+            VkDeviceSize usedBytes = 0;
+            VkDeviceSize largestFree = 0;
+            for (const Block& block : blocks_)
+            {
+                if ((block.memory == VK_NULL_HANDLE) || (heapOf(block.memoryType) != heap))
+                {
+                    continue;
+                }
+                blockCount += 1;
+                subAllocationCount += block.allocationCount;
+                blockBytes += block.tlsf.size();
+                usedBytes += block.tlsf.used();
+                largestFree = std::max(largestFree, block.tlsf.largestFree());
+            }
+            if ((blockCount == 0) && (dedicatedCount_[heap] == 0))
+            {
+                continue;
+            }
+            const VkMemoryHeap& info = memoryProperties_.memoryHeaps[heap];
+            std::println("Memory heap {} ({}, {:.0f} MiB): {} blocks, {:.1f} of {:.1f} MiB used by {} allocations"
+                         " (largest free {:.1f} MiB); {} dedicated, {:.1f} MiB",
+                heap, (info.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "device local" : "host", info.size / kMiB,
+                blockCount, usedBytes / kMiB, blockBytes / kMiB, subAllocationCount, largestFree / kMiB,
+                dedicatedCount_[heap], dedicatedBytes_[heap] / kMiB);
+        }
+        std::println("Memory: {} VkDeviceMemory objects (limit {}), bufferImageGranularity {}", allocationCount_,
+            maxAllocationCount_, bufferImageGranularity_);
+    }
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        unsigned char* mapped = nullptr;
+        uint32_t memoryType = 0;
+        bool linear = false;
+        uint32_t allocationCount = 0;
+        TlsfAllocator tlsf;
+    };
+
+    uint32_t heapOf(uint32_t memoryType) const
+    {
+        return memoryProperties_.memoryTypes[memoryType].heapIndex;
+    }
+
+    // Small heaps (e.g. 256 MiB BAR memory) get proportionally smaller blocks.
+    VkDeviceSize blockSizeFor(uint32_t memoryType) const
+    {
+        const VkDeviceSize heapSize = memoryProperties_.memoryHeaps[heapOf(memoryType)].size;
+        return std::min(blockSize_, std::bit_floor(std::max<VkDeviceSize>(heapSize / 8, TlsfAllocator::kMinAlignment)));
+    }
+
+    VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, unsigned char*& mapped)
+    {
+        KK_VERIFY(allocationCount_ < maxAllocationCount_);
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        KK_VERIFY_VK(vkAllocateMemory(device_, &allocInfo, nullptr, &memory));
+        allocationCount_ += 1;
+
+        mapped = nullptr;
+        if (memoryProperties_.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            void* data = nullptr;
+            KK_VERIFY_VK(vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, &data));
+            mapped = static_cast<unsigned char*>(data);
+        }
+        return memory;
+    }
+
+    DeviceAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryType)
+    {
+        DeviceAllocation allocation{};
+        allocation.memory = allocateMemory(size, memoryType, allocation.mapped);
+        allocation.size = size;
+        allocation.memoryType = memoryType;
+        allocation.block = kDedicated;
+        const uint32_t heap = heapOf(memoryType);
+        dedicatedCount_[heap] += 1;
+        dedicatedBytes_[heap] += size;
+        return allocation;
+    }
+
+    DeviceAllocation makeAllocation(uint32_t index, uint32_t chunk, VkDeviceSize offset, VkDeviceSize size)
+    {
+        Block& block = blocks_[index];
+        block.allocationCount += 1;
+        DeviceAllocation allocation{};
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block.mapped ? (block.mapped + offset) : nullptr;
+        allocation.memoryType = block.memoryType;
+        allocation.block = index;
+        allocation.chunk = chunk;
+        return allocation;
+    }
+
+    uint32_t createBlock(uint32_t memoryType, bool linear, VkDeviceSize size)
+    {
+        uint32_t index = 0;
+        while ((index < blocks_.size()) && (blocks_[index].memory != VK_NULL_HANDLE))
+        {
+            ++index;
+        }
+        if (index == blocks_.size())
+        {
+            blocks_.emplace_back();
+        }
+        Block& block = blocks_[index];
+        block.memory = allocateMemory(size, memoryType, block.mapped);
+        block.memoryType = memoryType;
+        block.linear = linear;
+        block.allocationCount = 0;
+        block.tlsf.init(size);
+        return index;
+    }
+
+    void destroyBlock(uint32_t index)
+    {
+        vkFreeMemory(device_, blocks_[index].memory, nullptr);
+        blocks_[index] = Block{};
+        allocationCount_ -= 1;
+    }
+
+    bool hasOtherEmptyBlock(uint32_t index) const
+    {
+        const Block& empty = blocks_[index];
+        for (uint32_t i = 0; i < blocks_.size(); ++i)
+        {
+            const Block& block = blocks_[i];
+            if ((i != index) && (block.memory != VK_NULL_HANDLE) && (block.allocationCount == 0)
+                && (block.memoryType == empty.memoryType) && (block.linear == empty.linear))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties_{};
+    VkDeviceSize bufferImageGranularity_ = 1;
+    uint32_t maxAllocationCount_ = 0;
+    VkDeviceSize blockSize_ = 0;
+    uint32_t allocationCount_ = 0; // live VkDeviceMemory objects
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> dedicatedCount_; // per heap
+    std::vector<VkDeviceSize> dedicatedBytes_;
+};
+
+// Copies of the model in the default scene, see makeInstanceGrid().
+constexpr uint32_t INSTANCE_COUNT = 1;
+// Gap between neighbouring instances, relative to the model's largest dimension.
+constexpr float INSTANCE_SPACING = 1.25f;
+
+// `count` transforms on a square grid in the XY plane (the model's ground plane), centered on the origin.
+// A single instance gets the identity transform.
+std::vector<glm::mat4> makeInstanceGrid(uint32_t count, float spacing)
+{
+    std::vector<glm::mat4> transforms;
+    transforms.reserve(count);
+    const uint32_t side = std::max(uint32_t(std::ceil(std::sqrt(double(count)))), 1u);
+    const float origin = -0.5f * spacing * float(side - 1);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const glm::vec3 position(origin + spacing * float(i % side), origin + spacing * float(i / side), 0.0f);
+        transforms.push_back(glm::translate(glm::mat4(1.0f), position));
+    }
+    return transforms;
+}
+
+// shaders/cull.comp: workgroup size along instances, and where the commands start in the indirect buffer
+// (after the draw count).
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+constexpr VkDeviceSize INDIRECT_COMMANDS_OFFSET = sizeof(uint32_t);
+
+// Uniform block of shaders/cull.comp (std140).
+struct CullConstants
+{
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition; // w: pixels per unit at distance 1, see selectLod()
+    uint32_t objectCount;
+    float meshRadius;
+};
+static_assert(sizeof(CullConstants) == 120);
+
+// Fixed-function state that differs between graphics pipeline variants; shaders, vertex layout, pipeline layout
+// and render pass are shared.
+struct GraphicsPipelineKey
+{
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    bool depthWrite = true;
+    bool alphaBlend = false;
+
+    bool operator==(const GraphicsPipelineKey&) const = default;
+
+    std::string describe() const
+    {
+        return std::string((polygonMode == VK_POLYGON_MODE_LINE) ? "wireframe" : "solid")
+               + ((cullMode == VK_CULL_MODE_NONE) ? ", two-sided" : ", back-face culled")
+               + (depthWrite ? ", depth write on" : ", depth write off")
+               + (alphaBlend ? ", alpha blended" : ", opaque");
+    }
+};
+
+// Every combination of GraphicsPipelineKey state, the default key first; wireframe needs fillModeNonSolid.
+std::vector<GraphicsPipelineKey> makeGraphicsPipelineKeys(bool wireframe)
+{
+    std::vector<GraphicsPipelineKey> keys;
+    for (VkPolygonMode polygonMode : {VK_POLYGON_MODE_FILL, VK_POLYGON_MODE_LINE})
+    {
+        for (VkCullModeFlags cullMode : {VkCullModeFlags(VK_CULL_MODE_BACK_BIT), VkCullModeFlags(VK_CULL_MODE_NONE)})
+        {
+            for (bool depthWrite : {true, false})
+            {
+                for (bool alphaBlend : {false, true})
+                {
+                    if ((polygonMode == VK_POLYGON_MODE_FILL) || wireframe)
+                    {
+                        keys.push_back({polygonMode, cullMode, depthWrite, alphaBlend});
+                    }
+                }
+            }
+        }
+    }
+    return keys;
+}
+
+// What a frame's recorded command buffers depend on, apart from buffer contents (UBO, instance transforms):
+// if these match, last time's command buffer for the same (frame in flight, swapchain image) can be resubmitted.
+struct FrameRecordingInputs
+{
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Bumped whenever buffers or descriptor sets the commands reference are recreated or rewritten.
+    uint64_t resourceGeneration = 0;
+    unsigned threadCount = 0;
+    bool gpuCulling = false;
+    bool drawPerInstance = false;
+    uint32_t instanceCount = 0;
+    uint32_t cullObjectCount = 0; // cull.comp dispatch size
+    // Baked into the MVPs pushed with drawPerInstance; identity otherwise, where the camera lives in the uniform ring
+    glm::mat4 drawViewProj{1.0f};
+    uint32_t uniformOffset = 0; // dynamic offsets into the uniform ring
+    uint32_t cullConstantsOffset = 0;
+    std::vector<MeshChunk> draws;
+    std::vector<uint32_t> instances; // drawn one by one (drawPerInstance), indices into instanceTransforms
+
+    bool operator==(const FrameRecordingInputs&) const = default;
+};
+
+// MeshDraws.lods of shaders/cull.comp: draw ranges (merged meshlets) of one LOD.
+struct GpuMeshLod
+{
+    float error = std::numeric_limits<float>::max(); // levels past the chain are never selected
+    uint32_t firstDraw = 0;
+    uint32_t drawCount = 0;
+    uint32_t padding = 0;
+};
+static_assert(sizeof(GpuMeshLod) == 16);
+
+struct UniformBufferObject
+{
+    alignas(16) glm::mat4 viewProj;
+    // MeshQuantization of the packed vertex stream
+    alignas(16) glm::vec4 positionOffset;
+    alignas(16) glm::vec4 positionScale;
+    alignas(16) glm::vec4 texCoordOffsetScale; // xy offset, zw scale
+};
+
+// Push constants of shaders/packed_vertex.vert; the model matrix comes from the per-instance stream (InstanceData).
+// Shared (instanced, GPU-culled) draws push the same constants every frame and read the camera from the UBO.
+struct DrawConstants
+{
+    glm::mat4 transform{1.0f}; // proj * view * model with an identity instance transform, when perDraw != 0
+    uint32_t material = 0;     // added to InstanceData::material; non-zero only with the identity instance
+    uint32_t perDraw = 0;
+};
+
+class HelloTriangleApplication
+{
+public:
+    void run()
+    {
+        initWindow();
+        initVulkan();
+        startShaderHotReload();
+        mainLoop();
+        cleanup();
+    }
+
+    // Startup upload cost for the model plus `textureCount` copies of the texture: one submission
+    // and wait per resource vs. one upload batch with a single fence.
+    void runUploadBenchmark(uint32_t textureCount)
+    {
+        initWindow();
+        createInstance();
+        setupDebugMessenger();
+        createSurface();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createCommandPool();
+        createStagingRing();
+
+        TextureData texture;
+        loadTexture(TEXTURE_PATH, texture);
+        loadModel();
+
+        std::vector<VkImage> images(textureCount);
+        std::vector<DeviceAllocation> imagesMemory(textureCount);
+        auto uploadScene = [&](bool batched) {
+            const uint32_t submitsBefore = uploadSubmitCount;
+            const auto start = std::chrono::steady_clock::now();
+            if (batched)
+            {
+                beginUploadBatch();
+            }
+            for (uint32_t i = 0; i < textureCount; ++i)
+            {
+                createTexture(texture, images[i], imagesMemory[i]);
+                retireUploads(!batched);
+            }
+            createVertexBuffer();
+            retireUploads(!batched);
+            createIndexBuffer();
+            retireUploads(!batched);
+            if (batched)
+            {
+                endUploadBatch();
+            }
+            const auto end = std::chrono::steady_clock::now();
+            std::println(" -- {:<12} {:>10.2f} ms, {:>4} submissions", batched ? "one batch" : "per resource",
+                std::chrono::duration<double, std::milli>(end - start).count(), uploadSubmitCount - submitsBefore);
+
+            for (uint32_t i = 0; i < textureCount; ++i)
+            {
+                vkDestroyImage(device, images[i], nullptr);
+                memoryAllocator.free(imagesMemory[i]);
+            }
+            vkDestroyBuffer(device, indexBuffer, nullptr);
+            memoryAllocator.free(indexBufferMemory);
+            vkDestroyBuffer(device, vertexBuffer, nullptr);
+            memoryAllocator.free(vertexBufferMemory);
+        };
+
+        std::println("'{}' + {} x '{}':", MODEL_PATH, textureCount, TEXTURE_PATH);
+        for (int run = 0; run < 3; ++run)
+        {
+            uploadScene(false);
+            uploadScene(true);
+        }
+        cleanupDevice();
+    }
 
-    static VkVertexInputBindingDescription getBindingDescription()
+    // Startup pipeline creation (graphics + cull pipelines) with an empty pipeline cache vs. one seeded in-process
+    // with the data the cold run produced, standing in for what loadPipelineCache() reads from disk.
+    void runPipelineCacheBenchmark()
     {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        initWindow();
+        createInstance();
+        setupDebugMessenger();
+        createSurface();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createCommandPool();
+        createStagingRing();
+        createSwapChain();
+        createRenderPass();
+        createDescriptorSetLayout();
 
-        return bindingDescription;
+        std::vector<unsigned char> cacheData;
+        auto createPipelines = [&](bool warm) {
+            if (!warm)
+            {
+                cacheData.clear();
+            }
+            createPipelineCache(cacheData);
+            const auto start = std::chrono::steady_clock::now();
+            createGraphicsPipeline();
+            createCullPipeline();
+            const auto end = std::chrono::steady_clock::now();
+            cacheData = getPipelineCacheData();
+            std::println(" -- {:<5} {:>10.2f} ms, {:>8} bytes of cache data", warm ? "warm" : "cold",
+                std::chrono::duration<double, std::milli>(end - start).count(), std::size(cacheData));
+
+            vkDestroyPipelineCache(device, pipelineCache, nullptr);
+            destroyPipelineVariants();
+            vkDestroyPipeline(device, graphicsPipeline, nullptr);
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            if (drawIndirectCountSupported)
+            {
+                vkDestroyPipeline(device, cullPipeline, nullptr);
+                vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+            }
+        };
+
+        std::println("Graphics + cull pipeline creation:");
+        for (int run = 0; run < 3; ++run)
+        {
+            createPipelines(false);
+            createPipelines(true);
+        }
+        destroyDescriptorSetLayouts();
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        cleanupDevice();
     }
 
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions()
+    // Wall time of compiling all graphics pipeline variants on 1..maxThreads threads (x2 per step), each run
+    // into a new, empty pipeline cache.
+    void runPipelineVariantsBenchmark(unsigned maxThreads)
     {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+        initWindow();
+        createInstance();
+        setupDebugMessenger();
+        createSurface();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createCommandPool();
+        createStagingRing();
+        createSwapChain();
+        createRenderPass();
+        createDescriptorSetLayout();
+        createPipelineCache({});
+        createGraphicsPipeline();
+        vkDestroyPipelineCache(device, pipelineCache, nullptr);
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+        const std::vector<GraphicsPipelineKey> keys = makeGraphicsPipelineKeys(fillModeNonSolidSupported);
+        std::vector<VkPipeline> pipelines(std::size(keys));
+        std::println("{} graphics pipeline variants:", std::size(keys));
+        std::vector<unsigned> threadCounts;
+        for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(std::max(maxThreads, 1u));
+        double singleThreadMs = 0.0;
+        for (unsigned threads : threadCounts)
+        {
+            createPipelineCache({});
+            WorkerPool workers(threads);
+            const auto start = std::chrono::steady_clock::now();
+            workers.run(unsigned(std::size(keys)), [&](unsigned variant) {
+                pipelines[variant] = createGraphicsPipelineVariant(keys[variant], vertShaderModule, fragShaderModule);
+            });
+            const auto end = std::chrono::steady_clock::now();
+
+            const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            singleThreadMs = (threads == 1) ? ms : singleThreadMs;
+            std::println(" -- {:>2} thread(s) {:>10.2f} ms, {:.2f}x", threads, ms, singleThreadMs / ms);
+            for (VkPipeline pipeline : pipelines)
+            {
+                vkDestroyPipeline(device, pipeline, nullptr);
+            }
+            vkDestroyPipelineCache(device, pipelineCache, nullptr);
+        }
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
+        destroyPipelineVariants();
+        vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        destroyDescriptorSetLayouts();
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+        cleanupDevice();
+    }
 
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+    // CPU cost of drawing 1..maxInstances copies of the model (x10 per step): one vkCmdDrawIndexed per instance
+    // vs. one instanced draw reading transforms from the per-instance stream (both without culling) vs. culling
+    // and indirect draws generated on the GPU, when supported.
+    void runInstancingBenchmark(uint32_t maxInstances)
+    {
+        initWindow();
+        initVulkan();
+        cullInstances = false;
+        const bool hasGpuCulling = gpuCulling;
 
-        return attributeDescriptions;
+        const int frameCount = 100;
+        std::println("'{}', {} triangles per instance at LOD 0, {} frames per run:", MODEL_PATH,
+            mesh.lods[0].indexCount / 3, frameCount);
+        for (uint32_t instanceCount = 1; instanceCount <= std::max(maxInstances, 1u); instanceCount *= 10)
+        {
+            setInstances(makeInstanceGrid(instanceCount, instanceSpacing()));
+            for (int mode = 0; mode < (hasGpuCulling ? 3 : 2); ++mode)
+            {
+                drawPerInstance = (mode == 0);
+                gpuCulling = (mode == 2);
+                for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+                {
+                    drawFrame(); // warm up: instance buffers and command buffers of every frame in flight
+                }
+                KK_VERIFY_VK(vkDeviceWaitIdle(device));
+
+                frameCpuSeconds = 0.0;
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < frameCount; ++i)
+                {
+                    glfwPollEvents();
+                    drawFrame();
+                }
+                KK_VERIFY_VK(vkDeviceWaitIdle(device));
+                const auto end = std::chrono::steady_clock::now();
+
+                const std::size_t drawCount =
+                    gpuCulling ? 1 : std::size(visibleDraws) * (drawPerInstance ? visibleInstanceCount : 1);
+                std::println(" -- {:>6} instances, {:<13} {:>9.3f} ms/frame, {:>8.3f} ms CPU (cull + record), {:>7} "
+                             "draw call(s)",
+                    instanceCount, std::array{"per instance", "instanced", "gpu culling"}[mode],
+                    std::chrono::duration<double, std::milli>(end - start).count() / frameCount,
+                    frameCpuSeconds * 1000.0 / frameCount, drawCount);
+            }
+            if (instanceCount > (std::numeric_limits<uint32_t>::max() / 10))
+            {
+                break;
+            }
+        }
+        cleanup();
     }
-};
-
-struct UniformBufferObject
-{
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
-};
 
-class HelloTriangleApplication
-{
-public:
-    void run()
+    // CPU cost of recording one draw per instance for `instanceCount` instances into secondary command
+    // buffers on 1..maxThreads threads (x2 per step), then of resubmitting the recorded ones.
+    void runRecordingBenchmark(uint32_t instanceCount, unsigned maxThreads)
     {
         initWindow();
         initVulkan();
-        mainLoop();
+        reuseCommandBuffers = false;
+        cullInstances = false;
+        gpuCulling = false;
+        drawPerInstance = true;
+        setInstances(makeInstanceGrid(instanceCount, instanceSpacing()));
+
+        const int frameCount = 100;
+        std::println("{} instances, one draw call each, {} frames per run:", instanceCount, frameCount);
+        double singleThreadSeconds = 0.0;
+        maxThreads = std::clamp(maxThreads, 1u, recordWorkers->threadCount());
+        std::vector<unsigned> threadCounts;
+        for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+        threadCounts.push_back(maxThreads); // once more, reusing the command buffers
+        for (std::size_t run = 0; run < std::size(threadCounts); ++run)
+        {
+            const unsigned threads = threadCounts[run];
+            reuseCommandBuffers = (run + 1 == std::size(threadCounts));
+            recordThreadCount = threads;
+            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+            {
+                drawFrame();
+            }
+            KK_VERIFY_VK(vkDeviceWaitIdle(device));
+
+            frameCpuSeconds = 0.0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frameCount; ++i)
+            {
+                glfwPollEvents();
+                drawFrame();
+            }
+            KK_VERIFY_VK(vkDeviceWaitIdle(device));
+            const auto end = std::chrono::steady_clock::now();
+
+            singleThreadSeconds = (run == 0) ? frameCpuSeconds : singleThreadSeconds;
+            std::println(" -- {:>2} thread(s){} {:>9.3f} ms/frame, {:>8.3f} ms CPU (cull + record), {:.2f}x", threads,
+                reuseCommandBuffers ? ", reused" : "",
+                std::chrono::duration<double, std::milli>(end - start).count() / frameCount,
+                frameCpuSeconds * 1000.0 / frameCount, singleThreadSeconds / frameCpuSeconds);
+        }
         cleanup();
     }
 
@@ -163,6 +4535,10 @@ private:
 
     VkQueue graphicsQueue = VK_NULL_HANDLE;
     VkQueue presentQueue = VK_NULL_HANDLE;
+    // Same as graphicsQueue when there is no dedicated transfer family.
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    uint32_t graphicsQueueFamily = 0;
+    uint32_t transferQueueFamily = 0;
 
     VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages{};
@@ -177,37 +4553,205 @@ private:
     VkPipeline graphicsPipeline = VK_NULL_HANDLE;
 
     VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+
+    // Upload submissions still in flight, oldest first. Their command buffers, semaphore and
+    // staging ring space are released once the fence signals (see retireUploads()).
+    struct PendingUpload
+    {
+        VkFence fence = VK_NULL_HANDLE;
+        VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+        VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+        VkSemaphore released = VK_NULL_HANDLE;
+        uint64_t stagingMark = 0;
+    };
+    std::deque<PendingUpload> pendingUploads;
+    uint32_t uploadSubmitCount = 0;
+
+    // Open between beginUploadBatch() and endUploadBatch(): uploads record into one transfer
+    // command buffer and their handoffs are collected for a single submission.
+    struct UploadBatch
+    {
+        bool active = false;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::vector<VkBufferMemoryBarrier> bufferHandoffs;
+        std::vector<VkImageMemoryBarrier> imageHandoffs;
+        VkPipelineStageFlags dstStageMask = 0;
+    };
+    UploadBatch uploadBatch;
+    DeviceMemoryAllocator memoryAllocator;
+    VkBuffer stagingRingBuffer = VK_NULL_HANDLE;
+    DeviceAllocation stagingRingMemory;
+    StagingRing stagingRing;
 
     VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
+    DeviceAllocation colorImageMemory;
     VkImageView colorImageView;
 
     VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
+    DeviceAllocation depthImageMemory;
     VkImageView depthImageView;
 
-    uint32_t mipLevels;
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
+    // Indexed by material ID, as loaded from MATERIAL_TEXTURES.
+    struct MaterialTexture
+    {
+        VkImage image = VK_NULL_HANDLE;
+        DeviceAllocation memory;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+    std::vector<MaterialTexture> materialTextures;
     VkSampler textureSampler;
 
-    std::vector<Vertex> vertices;
+    // Mesh built from the .obj; empty when loaded from the mesh cache.
+    std::vector<PackedVertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<uint16_t> indices16;
+    std::vector<MeshChunk> meshChunks;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> meshLods;
+    // What gets uploaded and drawn: views either the vectors above or the mapped mesh cache.
+    MappedFile meshCacheFile;
+    MeshView mesh;
+    // Meshlet ranges that survived culling this frame, adjacent ones merged into one draw.
+    std::vector<MeshChunk> visibleDraws;
+    uint64_t meshletsTested = 0;
+    uint64_t meshletsFrustumCulled = 0;
+    uint64_t meshletsBackfaceCulled = 0;
+    std::array<uint64_t, MAX_LOD_COUNT> lodFrameCount{};
+    // Per-meshlet AABBs of mesh.meshlets for the SIMD frustum test, and its output.
+    AabbSoA meshletBoxes;
+    std::vector<uint8_t> meshletVisible;
+    uint64_t meshFramesCulled = 0;
+
+    // Copies of the mesh, all drawn by the same vkCmdDrawIndexed. World-space AABBs for culling and
+    // the largest axis scale of each transform, to bring world distances back to model units for selectLod().
+    std::vector<glm::mat4> instanceTransforms;
+    std::vector<uint32_t> instanceMaterials;
+    AabbSoA instanceBoxes;
+    std::vector<uint8_t> instanceVisible;
+    std::vector<float> instanceScales;
+    // Per frame in flight: transforms of this frame's visible instances, read as InstanceData.
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<DeviceAllocation> instanceBuffersMemory;
+    uint32_t instanceCapacity = 0;
+    uint32_t visibleInstanceCount = 0;
+    // With drawPerInstance the transforms are pushed per draw instead (DrawConstants) and the instance stream is
+    // this single identity matrix.
+    std::vector<uint32_t> visibleInstances;
+    VkBuffer identityInstanceBuffer = VK_NULL_HANDLE;
+    DeviceAllocation identityInstanceBufferMemory;
+    // proj * view: UniformBufferObject::viewProj, and folded into the MVPs pushed with drawPerInstance.
+    glm::mat4 viewProj{1.0f};
+    // This frame's UniformBufferObject and cullConstants in uniformRing.
+    uint32_t uniformOffset = 0;
+    uint32_t cullConstantsOffset = 0;
+    uint64_t instancesTested = 0;
+    uint64_t instancesCulled = 0;
+    // Benchmark knobs: draw everything, and record one draw per instance instead of one instanced draw.
+    bool cullInstances = true;
+    bool drawPerInstance = false;
+    double frameCpuSeconds = 0.0;
+
+    // GPU-driven path, when VK_KHR_draw_indirect_count is available: cull.comp culls every instance, picks its
+    // LOD and appends indirect draws; one vkCmdDrawIndexedIndirectCountKHR draws them. The CPU does not touch
+    // instances per frame.
+    bool drawIndirectCountSupported = false;
+    bool gpuCulling = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+    VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    // With VK_EXT_descriptor_indexing, every material texture sits in one partially bound, update-after-bind
+    // array of sampled images (set 1, read by bindless.frag) indexed by the instance's material ID, so instances
+    // with different materials still share a draw. Otherwise packed_vertex.frag samples the first material's
+    // texture through set 0 for all of them.
+    bool physicalDeviceProperties2Supported = false; // instance extension, for vkGetPhysicalDeviceFeatures2KHR
+    bool bindlessTexturesSupported = false;
+    VkDescriptorSetLayout textureTableSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool textureTablePool = VK_NULL_HANDLE;
+    VkDescriptorSet textureTableSet = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    // Graphics pipeline variants other than graphicsPipeline (GraphicsPipelineKey{}), compiled in the background
+    // by pipelineCompileThread on pipelineWorkers; a variant's pipeline is non-null once it is ready to use.
+    struct PipelineVariant
+    {
+        GraphicsPipelineKey key;
+        std::atomic<VkPipeline> pipeline = VK_NULL_HANDLE;
+    };
+    std::vector<PipelineVariant> pipelineVariants;
+    std::unique_ptr<WorkerPool> pipelineWorkers;
+    std::jthread pipelineCompileThread;
+    std::atomic<bool> pipelineVariantsCompiling = false;
+    GraphicsPipelineKey activePipelineKey{};
+    // Shader hot reload, run() only: a rebuilt default pipeline (and its shaders) waiting for the next frame.
+    struct ShaderReload
+    {
+        VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+        VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+    std::mutex shaderReloadMutex;
+    std::optional<ShaderReload> pendingShaderReload;
+    std::jthread shaderReloadThread;
+    // Replaced pipelines, destroyed once the frames submitted before frameNumber are done.
+    struct RetiredPipeline
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        uint64_t frameNumber = 0;
+    };
+    std::deque<RetiredPipeline> retiredPipelines;
+    uint64_t frameNumber = 0; // frames submitted so far
+    bool fillModeNonSolidSupported = false;
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> cullDescriptorSets;
+    CullConstants cullConstants{};
+    // Per-LOD draw ranges as read by cull.comp (MeshDraws).
+    std::array<GpuMeshLod, MAX_LOD_COUNT> gpuLods{};
+    std::vector<MeshChunk> lodDraws;
+    uint32_t maxLodDrawCount = 0;
+    VkBuffer meshDrawBuffer = VK_NULL_HANDLE;
+    DeviceAllocation meshDrawBufferMemory;
+    // All instances, in order: transforms (instance stream) and world-space bounding spheres.
+    VkBuffer objectTransformBuffer = VK_NULL_HANDLE;
+    DeviceAllocation objectTransformBufferMemory;
+    VkBuffer objectBoundsBuffer = VK_NULL_HANDLE;
+    DeviceAllocation objectBoundsBufferMemory;
+    // Per frame in flight: draw count + commands written by cull.comp.
+    std::vector<VkBuffer> indirectBuffers;
+    std::vector<DeviceAllocation> indirectBuffersMemory;
 
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    DeviceAllocation vertexBufferMemory;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    DeviceAllocation indexBufferMemory;
 
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
-    std::vector<void*> uniformBuffersMapped;
+    // UniformBufferObject and cullConstants of every frame in flight, UNIFORM_RING_FRAME_SIZE bytes per frame.
+    VkBuffer uniformRingBuffer = VK_NULL_HANDLE;
+    DeviceAllocation uniformRingMemory;
+    UniformRing uniformRing;
 
     VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-    std::vector<VkDescriptorSet> descriptorSets;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE; // all frames: the uniform buffer binding is dynamic
 
-    std::vector<VkCommandBuffer> commandBuffers;
+    // A primary command buffer per (frame in flight, swapchain image), the per-thread pools and secondaries it
+    // executes, and the inputs it was last recorded with. drawFrame() resubmits it as is while those match.
+    struct RecordedFrame
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::vector<VkCommandPool> secondaryCommandPools;
+        std::vector<VkCommandBuffer> secondaryCommandBuffers;
+        FrameRecordingInputs inputs;
+        bool valid = false;
+    };
+    std::vector<RecordedFrame> recordedFrames; // [frame in flight * swapchain image count + image]
+    FrameRecordingInputs frameInputs;
+    uint64_t resourceGeneration = 0;
+    bool reuseCommandBuffers = true;
+    uint64_t framesRecorded = 0;
+    uint64_t framesReused = 0;
+    unsigned recordThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<WorkerPool> recordWorkers;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -226,6 +4770,7 @@ private:
         glfwSetWindowAttrib(window, GLFW_RESIZABLE, GLFW_TRUE);
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+        glfwSetKeyCallback(window, keyCallback);
     }
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -235,6 +4780,23 @@ private:
         app->framebufferResized = true;
     }
 
+    // V: switch to the next graphics pipeline variant.
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+    {
+        HelloTriangleApplication* app = static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        KK_VERIFY(app);
+        if ((key == GLFW_KEY_V) && (action == GLFW_PRESS))
+        {
+            const std::vector<GraphicsPipelineKey> keys = makeGraphicsPipelineKeys(app->fillModeNonSolidSupported);
+            const auto active = std::ranges::find(keys, app->activePipelineKey);
+            app->activePipelineKey = ((active + 1) < std::end(keys)) ? *(active + 1) : keys.front();
+            std::println("Pipeline: {}{}", app->activePipelineKey.describe(),
+                (app->currentGraphicsPipeline() == app->graphicsPipeline) && (app->activePipelineKey != keys.front())
+                    ? " (still compiling)"
+                    : "");
+        }
+    }
+
     void initVulkan()
     {
         createInstance();
@@ -242,26 +4804,39 @@ private:
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
+        loadPipelineCache();
         createSwapChain();
         createImageViews();
         createRenderPass();
         createDescriptorSetLayout();
         createGraphicsPipeline();
+        compilePipelineVariants();
+        createCullPipeline();
         createCommandPool();
+        createStagingRing();
         createColorResources();
         createDepthResources();
         createFramebuffers();
-        createTextureImage();
-        createTextureImageView();
+        beginUploadBatch();
+        createMaterialTextures();
         createTextureSampler();
         loadModel();
+        buildCullingBounds();
         createVertexBuffer();
         createIndexBuffer();
-        createUniformBuffers();
+        createIdentityInstanceBuffer();
+        if (drawIndirectCountSupported)
+        {
+            createMeshDrawBuffer();
+        }
+        endUploadBatch();
+        createUniformRing();
+        setInstances(makeInstanceGrid(INSTANCE_COUNT, instanceSpacing()));
         createDescriptorPool();
         createDescriptorSets();
         createCommandBuffers();
         createSyncObjects();
+        memoryAllocator.printStats();
     }
 
     void mainLoop()
@@ -269,19 +4844,37 @@ private:
         while (!glfwWindowShouldClose(window))
         {
             glfwPollEvents();
+            retireUploads(false);
             drawFrame();
         }
         KK_VERIFY_VK(vkDeviceWaitIdle(device));
+
+        std::println("Command buffers: recorded {} frame(s), reused {} frame(s)", framesRecorded, framesReused);
+        if (gpuCulling)
+        {
+            std::println("Instance culling: {} instance(s), on the GPU", std::size(instanceTransforms));
+            return;
+        }
+        const double tested = double(std::max<uint64_t>(meshletsTested, 1));
+        std::println("Meshlet culling: {:.1f}% outside the frustum, {:.1f}% back-facing",
+            100.0 * double(meshletsFrustumCulled) / tested, 100.0 * double(meshletsBackfaceCulled) / tested);
+        std::println("Instance culling: {} instance(s), {:.1f}% outside the frustum, all culled {} time(s)",
+            std::size(instanceTransforms),
+            100.0 * double(instancesCulled) / double(std::max<uint64_t>(instancesTested, 1)), meshFramesCulled);
+        for (std::size_t level = 0; level < std::size(mesh.lods); ++level)
+        {
+            std::println("LOD {} drawn in {} frame(s)", level, lodFrameCount[level]);
+        }
     }
 
     void cleanupSwapChain()
     {
         vkDestroyImageView(device, depthImageView, nullptr);
         vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        memoryAllocator.free(depthImageMemory);
         vkDestroyImageView(device, colorImageView, nullptr);
         vkDestroyImage(device, colorImage, nullptr);
-        vkFreeMemory(device, colorImageMemory, nullptr);
+        memoryAllocator.free(colorImageMemory);
         for (VkFramebuffer framebuffer : swapChainFramebuffers)
         {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
@@ -296,30 +4889,71 @@ private:
     void cleanup()
     {
         cleanupSwapChain();
+        if (shaderReloadThread.joinable())
+        {
+            shaderReloadThread.request_stop();
+            shaderReloadThread.join();
+        }
+        if (pendingShaderReload)
+        {
+            destroyShaderReload(*pendingShaderReload);
+            pendingShaderReload.reset();
+        }
+        retirePipelines(true);
+        destroyPipelineVariants();
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass, nullptr);
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        if (drawIndirectCountSupported)
         {
-            vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+            vkDestroyPipeline(device, cullPipeline, nullptr);
+            vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+            vkDestroyBuffer(device, meshDrawBuffer, nullptr);
+            memoryAllocator.free(meshDrawBufferMemory);
         }
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroyBuffer(device, uniformRingBuffer, nullptr);
+        memoryAllocator.free(uniformRingMemory);
+        destroyInstanceBuffers();
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        if (bindlessTexturesSupported)
+        {
+            vkDestroyDescriptorPool(device, textureTablePool, nullptr);
+        }
         vkDestroySampler(device, textureSampler, nullptr);
-        vkDestroyImageView(device, textureImageView, nullptr);
-        vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        for (MaterialTexture& texture : materialTextures)
+        {
+            vkDestroyImageView(device, texture.view, nullptr);
+            vkDestroyImage(device, texture.image, nullptr);
+            memoryAllocator.free(texture.memory);
+        }
+        destroyDescriptorSetLayouts();
+        vkDestroyBuffer(device, identityInstanceBuffer, nullptr);
+        memoryAllocator.free(identityInstanceBufferMemory);
         vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
+        memoryAllocator.free(indexBufferMemory);
         vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        memoryAllocator.free(vertexBufferMemory);
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
             vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
             vkDestroyFence(device, inFlightFences[i], nullptr);
         }
+        destroyCommandBuffers();
+        recordWorkers.reset();
+        savePipelineCache();
+        vkDestroyPipelineCache(device, pipelineCache, nullptr);
+        cleanupDevice();
+    }
+
+    // Everything created up to (and including) the staging ring.
+    void cleanupDevice()
+    {
+        retireUploads(true);
+        vkDestroyBuffer(device, stagingRingBuffer, nullptr);
+        memoryAllocator.free(stagingRingMemory);
+        memoryAllocator.destroy();
+        vkDestroyCommandPool(device, transferCommandPool, nullptr);
         vkDestroyCommandPool(device, commandPool, nullptr);
         vkDestroyDevice(device, nullptr);
         if (kEnableValidationLayers)
@@ -360,6 +4994,10 @@ private:
         createColorResources();
         createDepthResources();
         createFramebuffers();
+        // The image count may change, and new framebuffers may reuse the old handle values
+        destroyCommandBuffers();
+        createCommandBuffers();
+        ++resourceGeneration;
     }
 
     void createInstance()
@@ -473,6 +5111,10 @@ private:
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        if (indices.transferFamily)
+        {
+            uniqueQueueFamilies.insert(indices.transferFamily.value());
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -491,16 +5133,54 @@ private:
         queueCreateInfo.queueCount = 1;
         queueCreateInfo.pQueuePriorities = &queuePriority;
 
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        // Optional, for wireframe pipeline variants.
+        fillModeNonSolidSupported = supportedFeatures.fillModeNonSolid;
+        deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+
+        // Optional, for GPU culling: cull.comp writes firstInstance = instance index into the indirect commands.
+        std::vector<const char*> deviceExtensions(
+            std::begin(kRequiredDeviceExtensions), std::end(kRequiredDeviceExtensions));
+        drawIndirectCountSupported =
+            supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance
+            && isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCountSupported)
+        {
+            deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            deviceFeatures.multiDrawIndirect = VK_TRUE;
+            deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        }
+
+        // Optional, for the bindless texture table.
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        bindlessTexturesSupported = isDescriptorIndexingSupported(indexingFeatures);
+        if (bindlessTexturesSupported)
+        {
+            deviceExtensions.push_back(VK_KHR_MAINTENANCE_3_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            indexingFeatures = {};
+            indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = bindlessTexturesSupported ? &indexingFeatures : nullptr;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(std::size(kRequiredDeviceExtensions));
-        createInfo.ppEnabledExtensionNames = std::data(kRequiredDeviceExtensions);
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(std::size(deviceExtensions));
+        createInfo.ppEnabledExtensionNames = std::data(deviceExtensions);
 
         if (kEnableValidationLayers)
         {
@@ -514,8 +5194,32 @@ private:
         }
 
         KK_VERIFY_VK(vkCreateDevice(physicalDevice, &createInfo, nullptr, &device));
+        if (drawIndirectCountSupported)
+        {
+            cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+            KK_VERIFY(cmdDrawIndexedIndirectCount);
+        }
+        gpuCulling = drawIndirectCountSupported;
+        std::println("Culling: {}", gpuCulling ? "on the GPU, VK_KHR_draw_indirect_count" : "on the CPU");
+        std::println("Textures: {}",
+            bindlessTexturesSupported ? "bindless, VK_EXT_descriptor_indexing" : "first material's texture only");
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+        graphicsQueueFamily = indices.graphicsFamily.value();
+        transferQueueFamily = indices.transferFamily.value_or(graphicsQueueFamily);
+        vkGetDeviceQueue(device, transferQueueFamily, 0, &transferQueue);
+        if (indices.transferFamily)
+        {
+            std::println("Uploads: dedicated transfer queue family {}", transferQueueFamily);
+        }
+        else
+        {
+            std::println("Uploads: no transfer-only queue family, using the graphics queue");
+        }
+
+        memoryAllocator.init(physicalDevice, device, MEMORY_BLOCK_SIZE);
     }
 
     void createSwapChain()
@@ -661,7 +5365,7 @@ private:
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0;
         uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         uboLayoutBinding.pImmutableSamplers = nullptr;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -679,16 +5383,174 @@ private:
         layoutInfo.pBindings = bindings.data();
 
         KK_VERIFY_VK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout));
+
+        if (drawIndirectCountSupported)
+        {
+            // cull.comp: object bounds, mesh draws, indirect draws, constants
+            std::array<VkDescriptorSetLayoutBinding, 4> cullBindings{};
+            for (uint32_t i = 0; i < std::size(cullBindings); ++i)
+            {
+                cullBindings[i].binding = i;
+                cullBindings[i].descriptorCount = 1;
+                cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
+            cullBindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+            layoutInfo.pBindings = cullBindings.data();
+            KK_VERIFY_VK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout));
+        }
+
+        if (bindlessTexturesSupported)
+        {
+            // Texture table: sampler, textures[MAX_BINDLESS_TEXTURES]. Update-after-bind bindings can't share a
+            // set with the dynamic uniform buffer, hence a set of its own.
+            std::array<VkDescriptorSetLayoutBinding, 2> tableBindings{};
+            tableBindings[0].binding = 0;
+            tableBindings[0].descriptorCount = 1;
+            tableBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            tableBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+            tableBindings[1].binding = 1;
+            tableBindings[1].descriptorCount = MAX_BINDLESS_TEXTURES;
+            tableBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            tableBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+            // Slots without a texture are never read; new ones can be written while command buffers that use
+            // the table are pending.
+            const std::array<VkDescriptorBindingFlags, 2> bindingFlags = {0,
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+                    | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT};
+            VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+            layoutInfo.pNext = &bindingFlagsInfo;
+            layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+            layoutInfo.bindingCount = static_cast<uint32_t>(tableBindings.size());
+            layoutInfo.pBindings = tableBindings.data();
+            KK_VERIFY_VK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &textureTableSetLayout));
+        }
+    }
+
+    void destroyDescriptorSetLayouts()
+    {
+        if (bindlessTexturesSupported)
+        {
+            vkDestroyDescriptorSetLayout(device, textureTableSetLayout, nullptr);
+        }
+        if (drawIndirectCountSupported)
+        {
+            vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+        }
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
     }
 
+    void createPipelineCache(std::span<const unsigned char> initialData)
+    {
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = initialData.size();
+        cacheInfo.pInitialData = initialData.data();
+        KK_VERIFY_VK(vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache));
+    }
+
+    // Seeds the pipeline cache from PIPELINE_CACHE_PATH; starts empty when there is none or it is stale.
+    void loadPipelineCache()
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        MappedFile cacheFile;
+        std::span<const unsigned char> initialData;
+        if (cacheFile.open(PIPELINE_CACHE_PATH))
+        {
+            initialData = {cacheFile.data(), cacheFile.size()};
+            if (!isPipelineCacheCompatible(initialData, properties))
+            {
+                std::println("Pipeline cache: '{}' is corrupt or was written by another device or driver, ignored",
+                    PIPELINE_CACHE_PATH);
+                initialData = {};
+            }
+        }
+        createPipelineCache(initialData);
+    }
+
+    std::vector<unsigned char> getPipelineCacheData() const
+    {
+        std::size_t size = 0;
+        KK_VERIFY_VK(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr));
+        std::vector<unsigned char> data(size);
+        KK_VERIFY_VK(vkGetPipelineCacheData(device, pipelineCache, &size, std::data(data)));
+        data.resize(size);
+        return data;
+    }
+
+    void savePipelineCache()
+    {
+        writeFileAtomically(PIPELINE_CACHE_PATH, getPipelineCacheData());
+    }
+
+    void createCullPipeline()
+    {
+        if (!drawIndirectCountSupported)
+        {
+            return;
+        }
+        std::vector<char> compShaderCode = readFile("shaders/comp_cull.spv");
+        VkShaderModule compShaderModule = createShaderModule(compShaderCode);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
+        KK_VERIFY_VK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout));
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = compShaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = cullPipelineLayout;
+        KK_VERIFY_VK(vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline));
+
+        vkDestroyShaderModule(device, compShaderModule, nullptr);
+    }
+
+    const ShaderSource& fragmentShader() const
+    {
+        return bindlessTexturesSupported ? BINDLESS_FRAGMENT_SHADER : FRAGMENT_SHADER;
+    }
+
+    // Loads the shaders all variants share, creates the pipeline layout and compiles the default variant.
     void createGraphicsPipeline()
     {
-        std::vector<char> vertShaderCode = readFile("shaders/vert_27.spv");
-        std::vector<char> fragShaderCode = readFile("shaders/frag_27.spv");
+        vertShaderModule = createShaderModule(readFile(shaderPath(VERTEX_SHADER.spirv)));
+        fragShaderModule = createShaderModule(readFile(shaderPath(fragmentShader().spirv)));
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawConstants);
 
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        const std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, textureTableSetLayout};
+        pipelineLayoutInfo.setLayoutCount = bindlessTexturesSupported ? 2 : 1;
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        KK_VERIFY_VK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
 
+        graphicsPipeline = createGraphicsPipelineVariant(GraphicsPipelineKey{}, vertShaderModule, fragShaderModule);
+    }
+
+    // Thread-safe: only reads state that does not change after createGraphicsPipeline(), and the pipeline cache
+    // is internally synchronized.
+    VkPipeline createGraphicsPipelineVariant(
+        const GraphicsPipelineKey& key, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule) const
+    {
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -703,14 +5565,17 @@ private:
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = Vertex::getAttributeDescriptions();
+        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+            PackedVertex::getBindingDescription(), InstanceData::getBindingDescription()};
+        std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions{};
+        std::ranges::copy(PackedVertex::getAttributeDescriptions(), std::begin(attributeDescriptions));
+        std::ranges::copy(InstanceData::getAttributeDescriptions(), std::begin(attributeDescriptions) + 2);
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(std::size(bindingDescriptions));
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(std::size(attributeDescriptions));
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexBindingDescriptions = std::data(bindingDescriptions);
         vertexInputInfo.pVertexAttributeDescriptions = std::data(attributeDescriptions);
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -727,9 +5592,9 @@ private:
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
         rasterizer.depthClampEnable = VK_FALSE;
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.polygonMode = key.polygonMode;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.cullMode = key.cullMode;
         rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
         rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -741,7 +5606,7 @@ private:
         VkPipelineDepthStencilStateCreateInfo depthStencil{};
         depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
         depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
+        depthStencil.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
         depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
         depthStencil.depthBoundsTestEnable = VK_FALSE;
         depthStencil.stencilTestEnable = VK_FALSE;
@@ -749,7 +5614,13 @@ private:
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask =
             VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
+        colorBlendAttachment.blendEnable = key.alphaBlend ? VK_TRUE : VK_FALSE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
         VkPipelineColorBlendStateCreateInfo colorBlending{};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -768,14 +5639,6 @@ private:
         dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
         dynamicState.pDynamicStates = dynamicStates.data();
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-
-        KK_VERIFY_VK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
-
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.stageCount = 2;
@@ -793,12 +5656,185 @@ private:
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        KK_VERIFY_VK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline));
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        KK_VERIFY_VK(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
+        return pipeline;
+    }
+
+    // Compiles all other variants concurrently in the background; rendering goes on with graphicsPipeline and
+    // picks up a variant as soon as it is ready (see currentGraphicsPipeline()).
+    void compilePipelineVariants()
+    {
+        const std::vector<GraphicsPipelineKey> keys = makeGraphicsPipelineKeys(fillModeNonSolidSupported);
+        pipelineVariants = std::vector<PipelineVariant>(std::size(keys) - 1);
+        for (std::size_t i = 1; i < std::size(keys); ++i)
+        {
+            pipelineVariants[i - 1].key = keys[i];
+        }
+        if (!pipelineWorkers)
+        {
+            pipelineWorkers = std::make_unique<WorkerPool>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        pipelineVariantsCompiling = true;
+        pipelineCompileThread = std::jthread([this]() {
+            const auto start = std::chrono::steady_clock::now();
+            pipelineWorkers->run(unsigned(std::size(pipelineVariants)), [this](unsigned variant) {
+                pipelineVariants[variant].pipeline =
+                    createGraphicsPipelineVariant(pipelineVariants[variant].key, vertShaderModule, fragShaderModule);
+            });
+            const auto end = std::chrono::steady_clock::now();
+            std::println("Pipelines: {} variant(s) compiled in {:.2f} ms on {} thread(s)", std::size(pipelineVariants),
+                std::chrono::duration<double, std::milli>(end - start).count(), pipelineWorkers->threadCount());
+            pipelineVariantsCompiling = false;
+        });
+    }
+
+    static std::string shaderPath(const char* name)
+    {
+        return std::string(SHADER_DIRECTORY) + "/" + name;
+    }
+
+    // Watches SHADER_DIRECTORY; when the graphics GLSL changes, recompiles it and builds the new default pipeline
+    // on this thread. drawFrame() swaps it in (applyShaderReload()).
+    void startShaderHotReload()
+    {
+        shaderReloadThread = std::jthread([this](std::stop_token stop) {
+            DirectoryWatcher watcher(SHADER_DIRECTORY);
+            while (!stop.stop_requested())
+            {
+                const std::vector<std::string> changed = watcher.wait(std::chrono::milliseconds(200));
+                bool rebuild = false;
+                bool compiled = true;
+                for (const ShaderSource& shader : {VERTEX_SHADER, fragmentShader()})
+                {
+                    if (std::ranges::find(changed, shader.glsl) != std::end(changed))
+                    {
+                        rebuild = true;
+                        compiled = compileShader(shader) && compiled;
+                    }
+                }
+                if (rebuild && compiled)
+                {
+                    buildShaderReload();
+                }
+            }
+        });
+    }
+
+    static bool compileShader(const ShaderSource& shader)
+    {
+        const char* glslc = std::getenv("MY_glslc");
+        const std::string command =
+            std::string(glslc ? glslc : "glslc") + " " + shaderPath(shader.glsl) + " -o " + shaderPath(shader.spirv);
+        if (std::system(command.c_str()) != 0)
+        {
+            std::println(stderr, "Shaders: failed to compile '{}', keeping the current pipeline", shader.glsl);
+            return false;
+        }
+        return true;
+    }
+
+    void buildShaderReload()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        ShaderReload reload{};
+        reload.vertShaderModule = createShaderModule(readFile(shaderPath(VERTEX_SHADER.spirv)));
+        reload.fragShaderModule = createShaderModule(readFile(shaderPath(fragmentShader().spirv)));
+        reload.pipeline =
+            createGraphicsPipelineVariant(GraphicsPipelineKey{}, reload.vertShaderModule, reload.fragShaderModule);
+        const auto end = std::chrono::steady_clock::now();
+        std::println(
+            "Shaders: pipeline rebuilt in {:.2f} ms", std::chrono::duration<double, std::milli>(end - start).count());
+
+        std::lock_guard lock(shaderReloadMutex);
+        if (pendingShaderReload)
+        {
+            // Superseded before drawFrame() got to it: never used.
+            destroyShaderReload(*pendingShaderReload);
+        }
+        pendingShaderReload = reload;
+    }
+
+    void destroyShaderReload(const ShaderReload& reload)
+    {
+        vkDestroyPipeline(device, reload.pipeline, nullptr);
+        vkDestroyShaderModule(device, reload.fragShaderModule, nullptr);
+        vkDestroyShaderModule(device, reload.vertShaderModule, nullptr);
+    }
+
+    // At a frame boundary: makes the rebuilt pipeline the default one and recompiles the variants from the new
+    // shaders. Old pipelines may still be used by frames in flight and are retired by retirePipelines().
+    void applyShaderReload()
+    {
+        std::optional<ShaderReload> reload;
+        {
+            std::lock_guard lock(shaderReloadMutex);
+            if (!pendingShaderReload || pipelineVariantsCompiling)
+            {
+                return; // variants still compile from the old shader modules, try again next frame
+            }
+            reload.swap(pendingShaderReload);
+        }
+        pipelineCompileThread.join();
+        retiredPipelines.push_back({graphicsPipeline, frameNumber});
+        for (PipelineVariant& variant : pipelineVariants)
+        {
+            retiredPipelines.push_back({variant.pipeline, frameNumber});
+        }
+        pipelineVariants.clear();
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+
+        graphicsPipeline = reload->pipeline;
+        vertShaderModule = reload->vertShaderModule;
+        fragShaderModule = reload->fragShaderModule;
+        ++resourceGeneration; // recorded command buffers reference the old pipelines
+        compilePipelineVariants();
+    }
+
+    // Destroys pipelines no submitted frame can use anymore: once this frame's fence signaled, every frame up to
+    // frameNumber - MAX_FRAMES_IN_FLIGHT is done.
+    void retirePipelines(bool all)
+    {
+        while (!retiredPipelines.empty()
+               && (all || ((retiredPipelines.front().frameNumber + MAX_FRAMES_IN_FLIGHT) <= (frameNumber + 1))))
+        {
+            vkDestroyPipeline(device, retiredPipelines.front().pipeline, nullptr);
+            retiredPipelines.pop_front();
+        }
+    }
 
+    // Waits for the background compilation; also releases the shaders shared by the variants.
+    void destroyPipelineVariants()
+    {
+        if (pipelineCompileThread.joinable())
+        {
+            pipelineCompileThread.join();
+        }
+        for (PipelineVariant& variant : pipelineVariants)
+        {
+            vkDestroyPipeline(device, variant.pipeline, nullptr);
+        }
+        pipelineVariants.clear();
+        pipelineWorkers.reset();
         vkDestroyShaderModule(device, fragShaderModule, nullptr);
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
 
+    // The variant for activePipelineKey, or the default one while it is still compiling.
+    VkPipeline currentGraphicsPipeline() const
+    {
+        for (const PipelineVariant& variant : pipelineVariants)
+        {
+            if (variant.key == activePipelineKey)
+            {
+                const VkPipeline pipeline = variant.pipeline;
+                return (pipeline != VK_NULL_HANDLE) ? pipeline : graphicsPipeline;
+            }
+        }
+        return graphicsPipeline;
+    }
+
     void createFramebuffers()
     {
         KK_VERIFY(swapChainImageViews.size() > 0);
@@ -827,6 +5863,20 @@ private:
         poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
         KK_VERIFY_VK(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool));
+
+        VkCommandPoolCreateInfo transferPoolInfo{};
+        transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        transferPoolInfo.queueFamilyIndex = transferQueueFamily;
+        KK_VERIFY_VK(vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool));
+    }
+
+    void createStagingRing()
+    {
+        createBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingRingBuffer,
+            stagingRingMemory);
+        stagingRing.init(stagingRingBuffer, stagingRingMemory.mapped, STAGING_RING_SIZE);
     }
 
     void createColorResources()
@@ -885,122 +5935,101 @@ private:
                format == VK_FORMAT_D24_UNORM_S8_UINT;
     }
 
-    void createTextureImage()
+    void createMaterialTextures()
     {
-        int texWidth = 0;
-        int texHeight = 0;
-        int texChannels = 0;
-        stbi_uc* pixels = stbi_load(TEXTURE_PATH, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        KK_VERIFY(pixels);
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
-        mipLevels = uint32_t(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-        VkBuffer stagingBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-            stagingBufferMemory);
-
-        void* data = nullptr;
-        KK_VERIFY_VK(vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data));
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
-
-        stbi_image_free(pixels);
-
-        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-        copyBufferToImage(
-            stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
-
-        generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+        for (const char* path : MATERIAL_TEXTURES)
+        {
+            TextureData texture;
+            loadTexture(path, texture);
+            MaterialTexture& material = materialTextures.emplace_back();
+            createTexture(texture, material.image, material.memory);
+            material.view = createImageView(material.image, VkFormat(texture.header.format), VK_IMAGE_ASPECT_COLOR_BIT,
+                texture.header.levelCount);
+        }
     }
 
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+    void loadTexture(const char* path, TextureData& texture)
     {
-        // Check if image format supports linear blitting
-        VkFormatProperties formatProperties{};
-        vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
-        KK_VERIFY(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
-
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = image;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.subresourceRange.levelCount = 1;
-
-        int32_t mipWidth = texWidth;
-        int32_t mipHeight = texHeight;
-
-        for (uint32_t i = 1; i < mipLevels; i++)
+        MappedFile sourceFile;
+        KK_VERIFY(sourceFile.open(path));
+        const uint64_t sourceHash = hashBytes(sourceFile.data(), sourceFile.size());
+
+        // Either mapped from disk or baked right now; same layout in both cases.
+        const std::string cachePath = std::string(path) + TEXTURE_CACHE_SUFFIX;
+        TextureCacheHeader& header = texture.header;
+        if (texture.cacheFile.open(cachePath.c_str()) &&
+            viewTextureCache({texture.cacheFile.data(), texture.cacheFile.size()}, sourceHash, header))
         {
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
-                nullptr, 0, nullptr, 1, &barrier);
-
-            VkImageBlit blit{};
-            blit.srcOffsets[0] = {0, 0, 0};
-            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = {0, 0, 0};
-            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+            texture.file = {texture.cacheFile.data(), texture.cacheFile.size()};
+        }
+        else
+        {
+            texture.cacheFile.close();
+            int texWidth = 0;
+            int texHeight = 0;
+            int texChannels = 0;
+            stbi_uc* pixels = stbi_load_from_memory(
+                sourceFile.data(), int(sourceFile.size()), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            KK_VERIFY(pixels);
+            texture.ownedFile =
+                bakeTextureCache(pixels, uint32_t(texWidth), uint32_t(texHeight), sourceHash, TEXTURE_BAKE_FORMAT);
+            stbi_image_free(pixels);
+            writeFileAtomically(cachePath, texture.ownedFile);
+            KK_VERIFY(viewTextureCache(texture.ownedFile, sourceHash, header));
+            texture.file = texture.ownedFile;
+            std::println("Texture '{}': baked {} mip levels into '{}'", path, header.levelCount, cachePath);
+        }
+        sourceFile.close();
 
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        // Prefer the cached (compressed) format; otherwise decode on the CPU and upload plain RGBA8.
+        const VkFormat cachedFormat = VkFormat(header.format);
+        const VkFormat format = findSupportedFormat({cachedFormat, VK_FORMAT_R8G8B8A8_SRGB}, VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+        if (format != cachedFormat)
+        {
+            std::println("Texture '{}': {} is not supported by the device, decoding on the CPU", path,
+                getTextureFormatInfo(cachedFormat).name);
+            texture.ownedFile = decodeTextureCache(texture.file, header);
+            texture.cacheFile.close();
+            KK_VERIFY(viewTextureCache(texture.ownedFile, sourceHash, header));
+            texture.file = texture.ownedFile;
+        }
 
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                0, 0, nullptr, 0, nullptr, 1, &barrier);
+        TextureCacheHeader uncompressed = header;
+        uncompressed.format = VK_FORMAT_R8G8B8A8_SRGB;
+        uncompressed.layoutLevels();
+        const uint64_t uncompressedSize = uncompressed.payloadSize();
+        std::println("Texture '{}': {}x{} {}, {} mips, {} KiB ({} KiB as RGBA8, saved {} KiB)", path, header.width,
+            header.height, getTextureFormatInfo(format).name, header.levelCount, header.payloadSize() / 1024,
+            uncompressedSize / 1024, (uncompressedSize - header.payloadSize()) / 1024);
+    }
 
-            if (mipWidth > 1)
-            {
-                mipWidth /= 2;
-            }
-            if (mipHeight > 1)
-            {
-                mipHeight /= 2;
-            }
+    void createTexture(const TextureData& texture, VkImage& image, DeviceAllocation& imageMemory)
+    {
+        const TextureCacheHeader& header = texture.header;
+        // Levels are contiguous in the file; region offsets are relative to the first one.
+        const uint64_t payloadOffset = header.levels[0].offset;
+        const std::span<const unsigned char> payload = texture.file.subspan(payloadOffset, header.payloadSize());
+        std::vector<VkBufferImageCopy> regions(header.levelCount);
+        for (uint32_t i = 0; i < header.levelCount; ++i)
+        {
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = header.levels[i].offset - payloadOffset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = i;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {header.levelWidth(i), header.levelHeight(i), 1};
         }
 
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
-            nullptr, 0, nullptr, 1, &barrier);
+        createImage(header.width, header.height, header.levelCount, VK_SAMPLE_COUNT_1_BIT, VkFormat(header.format),
+            VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
 
-        endSingleTimeCommands(commandBuffer);
+        uploadImage(image, header.levelCount, payload, regions);
     }
 
     VkSampleCountFlagBits getMaxUsableSampleCount()
@@ -1038,11 +6067,6 @@ private:
         return VK_SAMPLE_COUNT_1_BIT;
     }
 
-    void createTextureImageView()
-    {
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
-    }
-
     void createTextureSampler()
     {
         VkPhysicalDeviceProperties properties{};
@@ -1063,7 +6087,7 @@ private:
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = float(mipLevels);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // shared by textures with different mip counts
         samplerInfo.mipLodBias = 0.0f;
 
         KK_VERIFY_VK(vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler));
@@ -1089,7 +6113,7 @@ private:
 
     void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
         VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-        VkImage& image, VkDeviceMemory& imageMemory)
+        VkImage& image, DeviceAllocation& imageMemory)
     {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1111,24 +6135,24 @@ private:
         VkMemoryRequirements memRequirements{};
         vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        KK_VERIFY_VK(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory));
-        KK_VERIFY_VK(vkBindImageMemory(device, image, imageMemory, 0));
+        // Render targets are big and get recreated with the swap chain: keep them out of the shared blocks.
+        const bool renderTarget =
+            (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+        imageMemory = memoryAllocator.allocate(
+            memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR, renderTarget);
+        KK_VERIFY_VK(vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset));
     }
 
-    void transitionImageLayout(
-        VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+    // Uploads mip levels from `payload` (region.bufferOffset is relative to it) and leaves every level
+    // of the image in SHADER_READ_ONLY_OPTIMAL, owned by the graphics queue family. Consecutive levels
+    // are grouped into copies of at most half the staging ring.
+    void uploadImage(VkImage image, uint32_t mipLevels, std::span<const unsigned char> payload,
+        std::span<const VkBufferImageCopy> regions)
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = image;
@@ -1137,228 +6161,757 @@ private:
         barrier.subresourceRange.levelCount = mipLevels;
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-        VkPipelineStageFlags sourceStage{};
-        VkPipelineStageFlags destinationStage{};
-
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && //
-            newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+        auto regionEnd = [&](std::size_t i) {
+            return (i + 1 < regions.size()) ? regions[i + 1].bufferOffset : VkDeviceSize(payload.size());
+        };
+        const VkDeviceSize maxGroupSize = stagingRing.capacity() / 2;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::size_t first = 0;
+        while (first < regions.size())
         {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            if (commandBuffer != VK_NULL_HANDLE)
+            {
+                // Submit the previous group first: allocateStaging() may have to wait for it.
+                endUploadCommands(commandBuffer, {}, {}, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            }
+            std::size_t last = first + 1;
+            while ((last < regions.size()) && ((regionEnd(last) - regions[first].bufferOffset) <= maxGroupSize))
+            {
+                ++last;
+            }
+            const VkDeviceSize groupOffset = regions[first].bufferOffset;
+            const VkDeviceSize groupSize = regionEnd(last - 1) - groupOffset;
+            const StagingRegion staging = allocateStaging(groupSize, TextureCacheHeader::kLevelAlignment);
+            memcpy(staging.data, payload.data() + groupOffset, size_t(groupSize));
+
+            std::vector<VkBufferImageCopy> group(regions.begin() + first, regions.begin() + last);
+            for (VkBufferImageCopy& region : group)
+            {
+                region.bufferOffset = staging.offset + (region.bufferOffset - groupOffset);
+            }
 
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            commandBuffer = beginUploadCommands();
+            if (first == 0)
+            {
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+            vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                uint32_t(group.size()), group.data());
+            first = last;
         }
-        else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && //
-                 newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        endUploadCommands(commandBuffer, {}, {&barrier, 1}, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    void loadModel()
+    {
+        MappedFile objFile;
+        KK_VERIFY(objFile.open(MODEL_PATH));
+        const uint64_t objHash = hashBytes(objFile.data(), objFile.size());
+
+        const std::string cachePath = std::string(MODEL_PATH) + MESH_CACHE_SUFFIX;
+        if (meshCacheFile.open(cachePath.c_str()))
         {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            if (viewMeshCache(meshCacheFile, objHash, mesh))
+            {
+                std::println("Model '{}': {} vertices, {} indices from '{}'", MODEL_PATH, std::size(mesh.vertices),
+                    mesh.indexCount(), cachePath);
+                printIndexFormat();
+                printMeshletStats();
+                printLodStats();
+                return;
+            }
+            meshCacheFile.close();
+        }
+
+        tinyobj::attrib_t attrib{};
+        std::vector<tinyobj::shape_t> shapes;
+        const std::string_view objText(reinterpret_cast<const char*>(objFile.data()), objFile.size());
+        KK_VERIFY(parseObj(objText, objParserThreadCount(objText.size()), attrib, shapes));
+        objFile.close();
+
+        std::vector<Vertex> unpacked;
+        buildDedupedMesh(attrib, shapes, unpacked, indices);
+        std::println("Model '{}': {} unique vertices out of {} total ({:.2f}x less vertex data)", MODEL_PATH,
+            std::size(unpacked), std::size(indices), double(std::size(indices)) / double(std::size(unpacked)));
+
+        const VertexCacheStats fileOrder = analyzeVertexCache(indices, std::size(unpacked), VERTEX_CACHE_SIZE);
+        buildLodChain(unpacked);
+        optimizeVertexFetch(unpacked, indices);
+        const VertexCacheStats optimized = analyzeVertexCache(
+            std::span(indices).first(meshLods[0].indexCount), std::size(unpacked), VERTEX_CACHE_SIZE);
+        std::println("Vertex cache ({} entries): ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", VERTEX_CACHE_SIZE,
+            fileOrder.acmr, optimized.acmr, fileOrder.atvr, optimized.atvr);
+        mesh.quantization = quantizeMesh(unpacked, vertices);
+        std::println("Vertex format: {} bytes packed vs {} unpacked ({:.2f}x less vertex bandwidth)",
+            sizeof(PackedVertex), sizeof(Vertex), double(sizeof(Vertex)) / double(sizeof(PackedVertex)));
+
+        selectIndexFormat();
+        printIndexFormat();
+        printMeshletStats();
+        printLodStats();
+        writeMeshCache(cachePath, objHash, mesh);
+    }
 
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    // Narrows `indices` to 16 bits when the mesh has few enough vertices, otherwise splits it into 16-bit chunks
+    // unless the duplicated vertices cost more than the index bytes saved.
+    void selectIndexFormat()
+    {
+        meshChunks.clear();
+        indices16.clear();
+        if (std::size(vertices) <= kMaxIndex16Vertices)
+        {
+            indices16.reserve(std::size(indices));
+            for (uint32_t index : indices)
+            {
+                indices16.push_back(uint16_t(index));
+            }
+            meshChunks.push_back({0, uint32_t(std::size(indices16)), 0});
         }
         else
         {
-            KK_VERIFY(false);
+            std::vector<PackedVertex> chunkVertices;
+            splitMeshForIndex16(vertices, indices, meshlets, chunkVertices, indices16, meshChunks);
+            const std::size_t addedVertices = std::size(chunkVertices) - std::size(vertices);
+            const std::size_t savedIndexBytes = std::size(indices) * (sizeof(uint32_t) - sizeof(uint16_t));
+            if ((addedVertices * sizeof(PackedVertex)) < savedIndexBytes)
+            {
+                vertices = std::move(chunkVertices);
+            }
+            else
+            {
+                indices16.clear();
+                meshChunks.assign(1, {0, uint32_t(std::size(indices)), 0});
+                for (Meshlet& meshlet : meshlets)
+                {
+                    meshlet.vertexOffset = 0;
+                }
+            }
         }
 
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        mesh.vertices = vertices;
+        mesh.chunks = meshChunks;
+        mesh.meshlets = meshlets;
+        mesh.lods = meshLods;
+        if (!indices16.empty())
+        {
+            mesh.indexType = VK_INDEX_TYPE_UINT16;
+            mesh.indices = {reinterpret_cast<const unsigned char*>(std::data(indices16)),
+                std::size(indices16) * sizeof(uint16_t)};
+            indices = {}; // free the 32-bit copy
+        }
+        else
+        {
+            mesh.indexType = VK_INDEX_TYPE_UINT32;
+            mesh.indices = {reinterpret_cast<const unsigned char*>(std::data(indices)),
+                std::size(indices) * sizeof(uint32_t)};
+        }
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    void printIndexFormat()
+    {
+        const std::size_t indexCount = mesh.indexCount();
+        std::println("Index format: {} in {} chunk(s), {:.1f} KiB of indices ({:.1f} KiB as uint32)",
+            (mesh.indexType == VK_INDEX_TYPE_UINT16) ? "uint16" : "uint32", std::size(mesh.chunks),
+            double(mesh.indices.size_bytes()) / 1024.0, double(indexCount * sizeof(uint32_t)) / 1024.0);
     }
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+    // Replaces `indices` (the full-detail mesh) with all LODs back to back, each optimized for the vertex cache
+    // and overdraw and split into meshlets.
+    void buildLodChain(std::span<const Vertex> unpacked)
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        glm::vec3 minPos = unpacked.empty() ? glm::vec3(0.0f) : unpacked[0].pos;
+        glm::vec3 maxPos = minPos;
+        for (const Vertex& vertex : unpacked)
+        {
+            minPos = glm::min(minPos, vertex.pos);
+            maxPos = glm::max(maxPos, vertex.pos);
+        }
+        const float maxError = LOD_MAX_RELATIVE_ERROR * glm::length(maxPos - minPos);
+
+        std::vector<uint32_t> lodIndices = std::move(indices);
+        indices.clear();
+        meshlets.clear();
+        meshLods.clear();
+        float lodError = 0.0f;
+        while (meshLods.size() < MAX_LOD_COUNT)
+        {
+            if (!meshLods.empty())
+            {
+                const std::size_t previousCount = lodIndices.size();
+                const std::size_t target = std::size_t(float(previousCount / 3) * LOD_REDUCTION) * 3;
+                float simplifyError = 0.0f;
+                lodIndices = simplifyMesh(unpacked, lodIndices, target, maxError, simplifyError);
+                if ((lodIndices.size() == 0) || (float(lodIndices.size()) > float(previousCount) * LOD_MIN_REDUCTION))
+                {
+                    break;
+                }
+                lodError += simplifyError; // errors of successive simplifications add up at most
+            }
 
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {width, height, 1};
+            lodIndices = optimizeVertexCache(lodIndices, std::size(unpacked), VERTEX_CACHE_SIZE);
+            optimizeOverdraw(unpacked, lodIndices, VERTEX_CACHE_SIZE, OVERDRAW_CACHE_THRESHOLD);
+            std::vector<uint32_t> lodMeshletIndices = lodIndices;
+            std::vector<Meshlet> lodMeshlets = buildMeshlets(unpacked, lodMeshletIndices);
+
+            MeshLod lod{};
+            lod.firstMeshlet = uint32_t(std::size(meshlets));
+            lod.meshletCount = uint32_t(std::size(lodMeshlets));
+            lod.indexCount = uint32_t(std::size(lodMeshletIndices));
+            lod.error = lodError;
+            meshLods.push_back(lod);
+            for (Meshlet& meshlet : lodMeshlets)
+            {
+                meshlet.firstIndex += uint32_t(std::size(indices));
+                meshlets.push_back(meshlet);
+            }
+            indices.insert(std::end(indices), std::begin(lodMeshletIndices), std::end(lodMeshletIndices));
+        }
+    }
 
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    void printLodStats()
+    {
+        for (std::size_t level = 0; level < std::size(mesh.lods); ++level)
+        {
+            const MeshLod& lod = mesh.lods[level];
+            std::println("LOD {}: {} triangles in {} meshlets, error {:.5f}", level, lod.indexCount / 3,
+                lod.meshletCount, lod.error);
+        }
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    // Coarsest LOD whose error projects to at most LOD_PIXEL_ERROR pixels. `distance` is from the camera to the
+    // mesh bounds in model units, `pixelsPerUnit` the projected size of one unit at distance 1
+    // (proj[1][1] * viewport height / 2).
+    uint32_t selectLod(float distance, float pixelsPerUnit) const
+    {
+        distance = std::max(distance, 1e-3f);
+        uint32_t level = 0;
+        while (((level + 1) < std::size(mesh.lods))
+               && ((mesh.lods[level + 1].error / distance * pixelsPerUnit) <= LOD_PIXEL_ERROR))
+        {
+            ++level;
+        }
+        return level;
     }
 
-    void loadModel()
+    void printMeshletStats()
     {
-        tinyobj::attrib_t attrib{};
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn;
-        std::string err;
+        std::size_t vertexCount = 0;
+        std::size_t coneCount = 0;
+        for (const Meshlet& meshlet : mesh.meshlets)
+        {
+            vertexCount += meshlet.vertexCount;
+            coneCount += (meshlet.coneCutoff <= 1.0f) ? 1 : 0;
+        }
+        const double meshletCount = double(std::max<std::size_t>(std::size(mesh.meshlets), 1));
+        std::println("Meshlets: {} of up to {} vertices/{} triangles, {:.1f} vertices and {:.1f} triangles on average, "
+                     "{} with a usable normal cone",
+            std::size(mesh.meshlets), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, double(vertexCount) / meshletCount,
+            double(mesh.indexCount() / 3) / meshletCount, coneCount);
+    }
 
-        KK_VERIFY(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH));
+    void buildCullingBounds()
+    {
+        meshletBoxes.resize(std::size(mesh.meshlets));
+        for (std::size_t i = 0; i < std::size(mesh.meshlets); ++i)
+        {
+            meshletBoxes.set(i, mesh.meshlets[i].boundsMin, mesh.meshlets[i].boundsMax);
+        }
+        meshletVisible.resize(meshletBoxes.paddedCount());
 
-        std::uint64_t x = 0;
-        for (const tinyobj::shape_t& shape : shapes)
+        lodDraws.clear();
+        gpuLods = {};
+        for (std::size_t level = 0; level < std::size(mesh.lods); ++level)
         {
-            for (const tinyobj::index_t& index : shape.mesh.indices)
+            const MeshLod& meshLod = mesh.lods[level];
+            gpuLods[level].error = meshLod.error;
+            gpuLods[level].firstDraw = uint32_t(std::size(lodDraws));
+            for (uint32_t i = meshLod.firstMeshlet; i < (meshLod.firstMeshlet + meshLod.meshletCount); ++i)
             {
-                Vertex vertex{};
-                KK_VERIFY(index.vertex_index >= 0);
-                KK_VERIFY(index.texcoord_index >= 0);
+                appendMeshletDraw(lodDraws, mesh.meshlets[i]);
+            }
+            gpuLods[level].drawCount = uint32_t(std::size(lodDraws)) - gpuLods[level].firstDraw;
+            maxLodDrawCount = std::max(maxLodDrawCount, gpuLods[level].drawCount);
+        }
+    }
 
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0], //
-                    attrib.vertices[3 * index.vertex_index + 1], //
-                    attrib.vertices[3 * index.vertex_index + 2]  //
-                };
+    // Frustum (SIMD AABB) and normal cone culling per meshlet of `lod`, for a single instance.
+    // `clip` is proj * view * model, `cameraPosition` in model space.
+    void cullMeshlets(const glm::mat4& clip, const glm::vec3& cameraPosition, uint32_t lod)
+    {
+        const Frustum frustum(clip);
+        // All LODs share meshletBoxes; testing every box is cheaper than repacking a per-LOD subset
+        cullAabbs(frustum, meshletBoxes, meshletVisible.data());
+
+        // Back faces are drawn by two-sided (or front-culled) pipeline variants, so the cone test only applies with
+        // back-face culling on.
+        const bool cullBackfaces = (activePipelineKey.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+        const MeshLod& meshLod = mesh.lods[lod];
+        for (uint32_t i = meshLod.firstMeshlet; i < (meshLod.firstMeshlet + meshLod.meshletCount); ++i)
+        {
+            const Meshlet& meshlet = mesh.meshlets[i];
+            ++meshletsTested;
+            if (!meshletVisible[i])
+            {
+                ++meshletsFrustumCulled;
+                continue;
+            }
+            if (cullBackfaces && isMeshletBackfacing(meshlet, cameraPosition))
+            {
+                ++meshletsBackfaceCulled;
+                continue;
+            }
+            appendMeshletDraw(visibleDraws, meshlet);
+        }
+    }
 
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],       //
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1] // flip
-                };
+    static void appendMeshletDraw(std::vector<MeshChunk>& draws, const Meshlet& meshlet)
+    {
+        MeshChunk* last = draws.empty() ? nullptr : &draws.back();
+        if (last && (last->vertexOffset == meshlet.vertexOffset)
+            && ((last->firstIndex + last->indexCount) == meshlet.firstIndex))
+        {
+            last->indexCount += meshlet.indexCount;
+        }
+        else
+        {
+            draws.push_back({meshlet.firstIndex, meshlet.indexCount, meshlet.vertexOffset});
+        }
+    }
 
-                vertex.color = {1.0f, 1.0f, 1.0f};
-                vertices.push_back(vertex);
-                indices.push_back(uint32_t(indices.size()));
-                ++x;
+    // Culls instances against the frustum and writes the visible transforms to this frame's instance buffer.
+    // All visible instances share one LOD, picked for the nearest one, and one set of draws: meshlets are only
+    // culled when a single instance is visible (in its model space), otherwise the whole LOD is drawn.
+    // With gpuCulling, only fills the cull.comp constants: instances are culled and get their own LOD there.
+    void cullScene(const glm::mat4& view, const glm::mat4& proj)
+    {
+        visibleDraws.clear();
+        visibleInstances.clear();
+        visibleInstanceCount = 0;
+        const Frustum frustum(proj * view);
+        const glm::vec3 cameraPosition(glm::inverse(view)[3]);
+        const float meshRadius = glm::length(mesh.quantization.positionScale) * 0.5f;
+        const float pixelsPerUnit = std::abs(proj[1][1]) * 0.5f * float(swapChainExtent.height);
+        if (gpuCulling)
+        {
+            std::ranges::copy(frustum.planes, std::begin(cullConstants.frustumPlanes));
+            cullConstants.cameraPosition = glm::vec4(cameraPosition, pixelsPerUnit);
+            cullConstants.objectCount = uint32_t(std::size(instanceTransforms));
+            cullConstants.meshRadius = meshRadius;
+            const UniformRegion region = uniformRing.allocate(sizeof(cullConstants));
+            memcpy(region.data, &cullConstants, sizeof(cullConstants));
+            cullConstantsOffset = region.offset;
+            return;
+        }
+        if (cullInstances)
+        {
+            cullAabbs(frustum, instanceBoxes, instanceVisible.data());
+        }
+        else
+        {
+            std::ranges::fill(instanceVisible, uint8_t(1));
+        }
+
+        InstanceData* instances = reinterpret_cast<InstanceData*>(instanceBuffersMemory[currentFrame].mapped);
+        float nearest = std::numeric_limits<float>::max();
+        uint32_t lastVisible = 0;
+        for (uint32_t i = 0; i < instanceBoxes.count; ++i)
+        {
+            if (!instanceVisible[i])
+            {
+                continue;
+            }
+            if (drawPerInstance)
+            {
+                visibleInstances.push_back(i);
+            }
+            else
+            {
+                instances[visibleInstanceCount] = {instanceTransforms[i], instanceMaterials[i]};
             }
+            ++visibleInstanceCount;
+            const glm::vec3 center(instanceBoxes.centerX[i], instanceBoxes.centerY[i], instanceBoxes.centerZ[i]);
+            nearest = std::min(nearest, glm::distance(cameraPosition, center) / instanceScales[i] - meshRadius);
+            lastVisible = i;
+        }
+        instancesTested += instanceBoxes.count;
+        instancesCulled += instanceBoxes.count - visibleInstanceCount;
+        if (visibleInstanceCount == 0)
+        {
+            ++meshFramesCulled;
+            return;
+        }
+
+        const uint32_t lod = selectLod(nearest, pixelsPerUnit);
+        ++lodFrameCount[lod];
+        if (visibleInstanceCount == 1)
+        {
+            const glm::mat4 modelView = view * instanceTransforms[lastVisible];
+            cullMeshlets(proj * modelView, glm::vec3(glm::inverse(modelView)[3]), lod);
+            return;
+        }
+        const MeshLod& meshLod = mesh.lods[lod];
+        for (uint32_t i = meshLod.firstMeshlet; i < (meshLod.firstMeshlet + meshLod.meshletCount); ++i)
+        {
+            appendMeshletDraw(visibleDraws, mesh.meshlets[i]);
         }
     }
 
     void createVertexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(Vertex) * std::size(vertices);
-        VkBuffer stagingBuffer{};
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-            stagingBufferMemory);
-
-        void* data = nullptr;
-        KK_VERIFY_VK(vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data));
-        memcpy(data, std::data(vertices), size_t(bufferSize));
-        vkUnmapMemory(device, stagingBufferMemory);
-
+        VkDeviceSize bufferSize = mesh.vertices.size_bytes();
         createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        uploadBuffer(vertexBuffer, std::data(mesh.vertices), bufferSize, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
     }
 
     void createIndexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * std::size(indices);
-
-        VkBuffer stagingBuffer{};
-        VkDeviceMemory stagingBufferMemory{};
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-            stagingBufferMemory);
-
-        void* data = nullptr;
-        KK_VERIFY_VK(vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data));
-        memcpy(data, std::data(indices), size_t(bufferSize));
-        vkUnmapMemory(device, stagingBufferMemory);
-
+        VkDeviceSize bufferSize = mesh.indices.size_bytes();
         createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+        uploadBuffer(indexBuffer, std::data(mesh.indices), bufferSize, VK_ACCESS_INDEX_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    }
+
+    void createIdentityInstanceBuffer()
+    {
+        const InstanceData identity{glm::mat4(1.0f)};
+        createBuffer(sizeof(identity), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, identityInstanceBuffer, identityInstanceBufferMemory);
+        uploadBuffer(identityInstanceBuffer, &identity, sizeof(identity), VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+    }
 
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    void createMeshDrawBuffer()
+    {
+        const VkDeviceSize lodsSize = sizeof(gpuLods);
+        const VkDeviceSize bufferSize = lodsSize + sizeof(MeshChunk) * std::size(lodDraws);
+        std::vector<unsigned char> data(bufferSize);
+        memcpy(std::data(data), std::data(gpuLods), lodsSize);
+        memcpy(std::data(data) + lodsSize, std::data(lodDraws), bufferSize - lodsSize);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, meshDrawBuffer, meshDrawBufferMemory);
+        uploadBuffer(meshDrawBuffer, std::data(data), bufferSize, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    void createUniformRing()
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        createBuffer(UNIFORM_RING_FRAME_SIZE * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformRingBuffer,
+            uniformRingMemory);
+        uniformRing.init(uniformRingBuffer, uniformRingMemory.mapped, UNIFORM_RING_FRAME_SIZE,
+            std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1));
     }
 
-    void createUniformBuffers()
+    void createInstanceBuffers(uint32_t capacity)
     {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+        VkDeviceSize bufferSize = sizeof(InstanceData) * std::max(capacity, 1u);
+
+        instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        instanceBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
 
-        uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffers[i],
+                instanceBuffersMemory[i]);
+        }
+        instanceCapacity = capacity;
 
+        if (!drawIndirectCountSupported)
+        {
+            return;
+        }
+        createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, objectTransformBuffer,
+            objectTransformBufferMemory);
+        createBuffer(sizeof(glm::vec4) * std::max(capacity, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, objectBoundsBuffer,
+            objectBoundsBufferMemory);
+        indirectBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        indirectBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i],
-                uniformBuffersMemory[i]);
+            createBuffer(indirectBufferSize(),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                    | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffers[i], indirectBuffersMemory[i]);
+        }
+        if (!cullDescriptorSets.empty())
+        {
+            updateCullDescriptorSets();
+        }
+    }
+
+    // Draw count, then one VkDrawIndexedIndirectCommand per (instance, draw range of its LOD) at most.
+    uint32_t maxIndirectDrawCount() const
+    {
+        return std::max(instanceCapacity, 1u) * std::max(maxLodDrawCount, 1u);
+    }
+
+    VkDeviceSize indirectBufferSize() const
+    {
+        return INDIRECT_COMMANDS_OFFSET + sizeof(VkDrawIndexedIndirectCommand) * VkDeviceSize(maxIndirectDrawCount());
+    }
+
+    void destroyInstanceBuffers()
+    {
+        for (size_t i = 0; i < std::size(instanceBuffers); i++)
+        {
+            vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+            memoryAllocator.free(instanceBuffersMemory[i]);
+        }
+        instanceBuffers.clear();
+        instanceBuffersMemory.clear();
+        instanceCapacity = 0;
+
+        if (!drawIndirectCountSupported)
+        {
+            return;
+        }
+        vkDestroyBuffer(device, objectTransformBuffer, nullptr);
+        memoryAllocator.free(objectTransformBufferMemory);
+        vkDestroyBuffer(device, objectBoundsBuffer, nullptr);
+        memoryAllocator.free(objectBoundsBufferMemory);
+        for (size_t i = 0; i < std::size(indirectBuffers); i++)
+        {
+            vkDestroyBuffer(device, indirectBuffers[i], nullptr);
+            memoryAllocator.free(indirectBuffersMemory[i]);
+        }
+        indirectBuffers.clear();
+        indirectBuffersMemory.clear();
+    }
+
+    float instanceSpacing() const
+    {
+        const glm::vec3& size = mesh.quantization.positionScale;
+        return INSTANCE_SPACING * std::max({size.x, size.y, size.z});
+    }
+
+    // Replaces the scene's instances; waits for the GPU to be done with the instance buffers and grows them
+    // when needed.
+    void setInstances(std::vector<glm::mat4> transforms)
+    {
+        KK_VERIFY_VK(vkDeviceWaitIdle(device));
+        ++resourceGeneration;
+        instanceTransforms = std::move(transforms);
+        const uint32_t count = uint32_t(std::size(instanceTransforms));
+        const glm::vec3 extent = mesh.quantization.positionScale * 0.5f;
+        const glm::vec4 center(mesh.quantization.positionOffset + extent, 1.0f);
+        instanceMaterials.resize(count);
+        instanceBoxes.resize(count);
+        instanceScales.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            instanceMaterials[i] = i % uint32_t(std::size(MATERIAL_TEXTURES));
+            const glm::mat4& model = instanceTransforms[i];
+            const glm::vec3 worldCenter(model * center);
+            const glm::vec3 worldExtent = glm::abs(glm::vec3(model[0])) * extent.x
+                                        + glm::abs(glm::vec3(model[1])) * extent.y
+                                        + glm::abs(glm::vec3(model[2])) * extent.z;
+            instanceBoxes.set(i, worldCenter - worldExtent, worldCenter + worldExtent);
+            instanceScales[i] = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])),
+                glm::length(glm::vec3(model[2]))});
+        }
+        instanceVisible.resize(instanceBoxes.paddedCount());
+
+        if (count > instanceCapacity)
+        {
+            if (!instanceBuffers.empty())
+            {
+                destroyInstanceBuffers();
+            }
+            createInstanceBuffers(count);
+        }
 
-            KK_VERIFY_VK(vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]));
+        if (!drawIndirectCountSupported)
+        {
+            return;
+        }
+        // All transforms in instance order: cull.comp draws instance i with firstInstance = i.
+        const float meshRadius = glm::length(mesh.quantization.positionScale) * 0.5f;
+        InstanceData* objects = reinterpret_cast<InstanceData*>(objectTransformBufferMemory.mapped);
+        glm::vec4* spheres = reinterpret_cast<glm::vec4*>(objectBoundsBufferMemory.mapped);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            objects[i] = {instanceTransforms[i], instanceMaterials[i]};
+            const glm::vec3 center(instanceBoxes.centerX[i], instanceBoxes.centerY[i], instanceBoxes.centerZ[i]);
+            spheres[i] = glm::vec4(center, meshRadius * instanceScales[i]);
         }
     }
 
     void createDescriptorPool()
     {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        // One graphics set shared by all frames, one cull.comp set per frame in flight.
+        std::array<VkDescriptorPoolSize, 3> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[0].descriptorCount = static_cast<uint32_t>(1 + MAX_FRAMES_IN_FLIGHT);
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].descriptorCount = 1;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[2].descriptorCount = static_cast<uint32_t>(3 * MAX_FRAMES_IN_FLIGHT);
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolInfo.maxSets = static_cast<uint32_t>(1 + MAX_FRAMES_IN_FLIGHT);
 
         KK_VERIFY_VK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool));
+
+        if (bindlessTexturesSupported)
+        {
+            std::array<VkDescriptorPoolSize, 2> tableSizes{};
+            tableSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            tableSizes[0].descriptorCount = 1;
+            tableSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            tableSizes[1].descriptorCount = MAX_BINDLESS_TEXTURES;
+
+            poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+            poolInfo.poolSizeCount = static_cast<uint32_t>(tableSizes.size());
+            poolInfo.pPoolSizes = tableSizes.data();
+            poolInfo.maxSets = 1;
+            KK_VERIFY_VK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &textureTablePool));
+        }
     }
 
     void createDescriptorSets()
     {
-        std::vector<VkDescriptorSetLayout> layouts;
-        layouts.resize(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
-
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        allocInfo.pSetLayouts = layouts.data();
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        KK_VERIFY_VK(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = uniformRing.buffer();
+        bufferInfo.offset = 0; // + dynamic offset of the frame's UniformBufferObject
+        bufferInfo.range = sizeof(UniformBufferObject);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = materialTextures[0].view;
+        imageInfo.sampler = textureSampler;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = descriptorSet;
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = descriptorSet;
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(
+            device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+        if (drawIndirectCountSupported)
+        {
+            std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, cullDescriptorSetLayout);
+            allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+            allocInfo.pSetLayouts = layouts.data();
+            cullDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+            KK_VERIFY_VK(vkAllocateDescriptorSets(device, &allocInfo, cullDescriptorSets.data()));
+            updateCullDescriptorSets();
+        }
+
+        if (bindlessTexturesSupported)
+        {
+            allocInfo.descriptorPool = textureTablePool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &textureTableSetLayout;
+            KK_VERIFY_VK(vkAllocateDescriptorSets(device, &allocInfo, &textureTableSet));
+            updateTextureTable();
+        }
+    }
+
+    // Material i goes to slot i of the texture table; slots past the last material stay unbound.
+    void updateTextureTable()
+    {
+        KK_VERIFY(std::size(materialTextures) <= MAX_BINDLESS_TEXTURES);
+        VkDescriptorImageInfo samplerInfo{};
+        samplerInfo.sampler = textureSampler;
+        std::vector<VkDescriptorImageInfo> imageInfos(std::size(materialTextures));
+        for (std::size_t i = 0; i < std::size(materialTextures); ++i)
+        {
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfos[i].imageView = materialTextures[i].view;
+        }
 
-        descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-        KK_VERIFY_VK(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()));
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = textureTableSet;
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pImageInfo = &samplerInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = textureTableSet;
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        descriptorWrites[1].descriptorCount = static_cast<uint32_t>(imageInfos.size());
+        descriptorWrites[1].pImageInfo = imageInfos.data();
+
+        vkUpdateDescriptorSets(
+            device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
 
+    // Points cull.comp at the current object and indirect buffers; they are recreated when the scene grows.
+    void updateCullDescriptorSets()
+    {
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(UniformBufferObject);
-
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
-            imageInfo.sampler = textureSampler;
-
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0;
-            descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
-
+            std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+            bufferInfos[0] = {objectBoundsBuffer, 0, VK_WHOLE_SIZE};
+            bufferInfos[1] = {meshDrawBuffer, 0, VK_WHOLE_SIZE};
+            bufferInfos[2] = {indirectBuffers[i], 0, VK_WHOLE_SIZE};
+            bufferInfos[3] = {uniformRing.buffer(), 0, sizeof(CullConstants)}; // + dynamic offset
+
+            std::array<VkWriteDescriptorSet, 4> descriptorWrites{};
+            for (uint32_t binding = 0; binding < std::size(descriptorWrites); ++binding)
+            {
+                descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[binding].dstSet = cullDescriptorSets[i];
+                descriptorWrites[binding].dstBinding = binding;
+                descriptorWrites[binding].dstArrayElement = 0;
+                descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorWrites[binding].descriptorCount = 1;
+                descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+            }
+            descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             vkUpdateDescriptorSets(
                 device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
     }
 
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory)
+        DeviceAllocation& bufferMemory)
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1370,22 +6923,16 @@ private:
         VkMemoryRequirements memRequirements{};
         vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        KK_VERIFY_VK(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory));
-
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        bufferMemory = memoryAllocator.allocate(memRequirements, properties, true, false);
+        KK_VERIFY_VK(vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset));
     }
 
-    VkCommandBuffer beginSingleTimeCommands()
+    VkCommandBuffer beginSingleTimeCommands(VkCommandPool pool)
     {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
+        allocInfo.commandPool = pool;
         allocInfo.commandBufferCount = 1;
 
         VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
@@ -1400,68 +6947,323 @@ private:
         return commandBuffer;
     }
 
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    // Submits commands recorded from transferCommandPool without waiting for them; queue
+    // submission order alone makes the results visible to later graphics work.
+    // The handoff barriers describe how the graphics queue uses the uploaded resources next
+    // (dstAccessMask, newLayout at dstStageMask). With a dedicated transfer family they become
+    // a release on the transfer queue plus a matching acquire on the graphics queue
+    // (queue family ownership transfer), otherwise a plain barrier.
+    void endTransferCommands(VkCommandBuffer transferCommands, std::span<const VkBufferMemoryBarrier> bufferHandoffs,
+        std::span<const VkImageMemoryBarrier> imageHandoffs, VkPipelineStageFlags dstStageMask)
     {
-        KK_VERIFY_VK(vkEndCommandBuffer(commandBuffer));
+        std::vector<VkBufferMemoryBarrier> bufferBarriers(bufferHandoffs.begin(), bufferHandoffs.end());
+        std::vector<VkImageMemoryBarrier> imageBarriers(imageHandoffs.begin(), imageHandoffs.end());
+        const bool hasHandoffs = !(bufferBarriers.empty() && imageBarriers.empty());
+        const bool ownershipTransfer = hasHandoffs && (transferQueueFamily != graphicsQueueFamily);
+        auto setQueueFamilies = [&](auto& barrier) {
+            barrier.srcQueueFamilyIndex = ownershipTransfer ? transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = ownershipTransfer ? graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        };
+        std::ranges::for_each(bufferBarriers, setQueueFamilies);
+        std::ranges::for_each(imageBarriers, setQueueFamilies);
+
+        PendingUpload upload{};
+        upload.transferCommands = transferCommands;
+        upload.stagingMark = stagingRing.mark();
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        KK_VERIFY_VK(vkCreateFence(device, &fenceInfo, nullptr, &upload.fence));
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.pCommandBuffers = &transferCommands;
+
+        if (!ownershipTransfer)
+        {
+            if (hasHandoffs)
+            {
+                vkCmdPipelineBarrier(transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr,
+                    uint32_t(bufferBarriers.size()), bufferBarriers.data(), uint32_t(imageBarriers.size()),
+                    imageBarriers.data());
+            }
+            KK_VERIFY_VK(vkEndCommandBuffer(transferCommands));
+            KK_VERIFY_VK(vkQueueSubmit(transferQueue, 1, &submitInfo, upload.fence));
+            ++uploadSubmitCount;
+            pendingUploads.push_back(upload);
+            return;
+        }
 
-        KK_VERIFY_VK(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
-        KK_VERIFY_VK(vkQueueWaitIdle(graphicsQueue));
+        // Release: the destination access mask is ignored on the releasing queue.
+        std::vector<VkBufferMemoryBarrier> bufferReleases = bufferBarriers;
+        std::vector<VkImageMemoryBarrier> imageReleases = imageBarriers;
+        std::ranges::for_each(bufferReleases, [](VkBufferMemoryBarrier& barrier) { barrier.dstAccessMask = 0; });
+        std::ranges::for_each(imageReleases, [](VkImageMemoryBarrier& barrier) { barrier.dstAccessMask = 0; });
+        vkCmdPipelineBarrier(transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, uint32_t(bufferReleases.size()), bufferReleases.data(), uint32_t(imageReleases.size()),
+            imageReleases.data());
+        KK_VERIFY_VK(vkEndCommandBuffer(transferCommands));
+
+        // Acquire: same ranges/layouts; the source access mask is ignored on the acquiring queue.
+        std::ranges::for_each(bufferBarriers, [](VkBufferMemoryBarrier& barrier) { barrier.srcAccessMask = 0; });
+        std::ranges::for_each(imageBarriers, [](VkImageMemoryBarrier& barrier) { barrier.srcAccessMask = 0; });
+        upload.acquireCommands = beginSingleTimeCommands(commandPool);
+        vkCmdPipelineBarrier(upload.acquireCommands, dstStageMask, dstStageMask, 0, 0, nullptr,
+            uint32_t(bufferBarriers.size()), bufferBarriers.data(), uint32_t(imageBarriers.size()),
+            imageBarriers.data());
+        KK_VERIFY_VK(vkEndCommandBuffer(upload.acquireCommands));
 
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        KK_VERIFY_VK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &upload.released));
+
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &upload.released;
+        KK_VERIFY_VK(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+        // The acquire waits for the transfer submission, so its fence covers both.
+        VkSubmitInfo acquireInfo{};
+        acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores = &upload.released;
+        acquireInfo.pWaitDstStageMask = &dstStageMask;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers = &upload.acquireCommands;
+        KK_VERIFY_VK(vkQueueSubmit(graphicsQueue, 1, &acquireInfo, upload.fence));
+        ++uploadSubmitCount;
+        pendingUploads.push_back(upload);
+    }
+
+    // Upload commands: the open upload batch's command buffer, or a new one submitted by endUploadCommands().
+    VkCommandBuffer beginUploadCommands()
+    {
+        if (!uploadBatch.active)
+        {
+            return beginSingleTimeCommands(transferCommandPool);
+        }
+        if (uploadBatch.commandBuffer == VK_NULL_HANDLE)
+        {
+            uploadBatch.commandBuffer = beginSingleTimeCommands(transferCommandPool);
+        }
+        return uploadBatch.commandBuffer;
     }
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+    // Same contract as endTransferCommands(); inside an upload batch the handoffs are deferred
+    // to endUploadBatch().
+    void endUploadCommands(VkCommandBuffer commandBuffer, std::span<const VkBufferMemoryBarrier> bufferHandoffs,
+        std::span<const VkImageMemoryBarrier> imageHandoffs, VkPipelineStageFlags dstStageMask)
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        if (!uploadBatch.active)
+        {
+            endTransferCommands(commandBuffer, bufferHandoffs, imageHandoffs, dstStageMask);
+            return;
+        }
+        KK_VERIFY(commandBuffer == uploadBatch.commandBuffer);
+        uploadBatch.bufferHandoffs.insert(
+            uploadBatch.bufferHandoffs.end(), bufferHandoffs.begin(), bufferHandoffs.end());
+        uploadBatch.imageHandoffs.insert(uploadBatch.imageHandoffs.end(), imageHandoffs.begin(), imageHandoffs.end());
+        if (!(bufferHandoffs.empty() && imageHandoffs.empty()))
+        {
+            uploadBatch.dstStageMask |= dstStageMask;
+        }
+    }
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    void beginUploadBatch()
+    {
+        KK_VERIFY(!uploadBatch.active);
+        uploadBatch.active = true;
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    // Submits the copies recorded so far (handoffs stay deferred) so their staging space can be recycled.
+    void flushUploadBatch()
+    {
+        if (uploadBatch.commandBuffer != VK_NULL_HANDLE)
+        {
+            endTransferCommands(uploadBatch.commandBuffer, {}, {}, 0);
+            uploadBatch.commandBuffer = VK_NULL_HANDLE;
+        }
     }
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    // Submits the batch together with all handoffs and waits for its single fence.
+    void endUploadBatch()
     {
-        VkPhysicalDeviceMemoryProperties memProperties{};
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        KK_VERIFY(uploadBatch.active);
+        UploadBatch batch = std::move(uploadBatch);
+        uploadBatch = {};
+        if ((batch.commandBuffer != VK_NULL_HANDLE) || !batch.bufferHandoffs.empty() || !batch.imageHandoffs.empty())
+        {
+            VkCommandBuffer commandBuffer = (batch.commandBuffer != VK_NULL_HANDLE)
+                                                ? batch.commandBuffer
+                                                : beginSingleTimeCommands(transferCommandPool);
+            endTransferCommands(commandBuffer, batch.bufferHandoffs, batch.imageHandoffs, batch.dstStageMask);
+        }
+        retireUploads(true);
+    }
 
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+    // Frees the resources of finished uploads, oldest first; with `wait` blocks until all are done.
+    void retireUploads(bool wait)
+    {
+        while (!pendingUploads.empty())
         {
-            if ((typeFilter & (1 << i)) //
-                && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            PendingUpload& upload = pendingUploads.front();
+            if (wait)
             {
-                return i;
+                KK_VERIFY_VK(vkWaitForFences(device, 1, &upload.fence, VK_TRUE, UINT64_MAX));
+            }
+            else if (vkGetFenceStatus(device, upload.fence) != VK_SUCCESS)
+            {
+                break;
+            }
+            stagingRing.release(upload.stagingMark);
+            vkDestroyFence(device, upload.fence, nullptr);
+            vkFreeCommandBuffers(device, transferCommandPool, 1, &upload.transferCommands);
+            if (upload.acquireCommands != VK_NULL_HANDLE)
+            {
+                vkFreeCommandBuffers(device, commandPool, 1, &upload.acquireCommands);
+                vkDestroySemaphore(device, upload.released, nullptr);
             }
+            pendingUploads.pop_front();
         }
-        KK_VERIFY(false);
-        return uint32_t(-1);
+    }
+
+    // Staging space for one upload; waits for the oldest uploads to finish while the ring is full.
+    StagingRegion allocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        retireUploads(false);
+        StagingRegion region{};
+        while (!stagingRing.tryAllocate(size, alignment, region))
+        {
+            // The open batch may be holding the space: submit what it has so far.
+            flushUploadBatch();
+            KK_VERIFY(!pendingUploads.empty());
+            KK_VERIFY_VK(vkWaitForFences(device, 1, &pendingUploads.front().fence, VK_TRUE, UINT64_MAX));
+            retireUploads(false);
+        }
+        return region;
+    }
+
+    // Copies `bytes` into dstBuffer through the staging ring, on the transfer queue; dstBuffer is then
+    // owned by the graphics family and visible to dstAccessMask at dstStageMask. Uploads bigger than
+    // half the ring are split into several submissions.
+    void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags dstStageMask)
+    {
+        const VkDeviceSize maxChunkSize = stagingRing.capacity() / 2;
+        VkDeviceSize offset = 0;
+        do
+        {
+            const VkDeviceSize chunkSize = std::min(maxChunkSize, size - offset);
+            const StagingRegion staging = allocateStaging(chunkSize, 16);
+            memcpy(staging.data, static_cast<const unsigned char*>(data) + offset, size_t(chunkSize));
+
+            VkCommandBuffer commandBuffer = beginUploadCommands();
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = staging.offset;
+            copyRegion.dstOffset = offset;
+            copyRegion.size = chunkSize;
+            vkCmdCopyBuffer(commandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+            offset += chunkSize;
+
+            if (offset < size)
+            {
+                endUploadCommands(commandBuffer, {}, {}, dstStageMask);
+                continue;
+            }
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = dstAccessMask;
+            barrier.buffer = dstBuffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            endUploadCommands(commandBuffer, {&barrier, 1}, {}, dstStageMask);
+        } while (offset < size);
     }
 
     void createCommandBuffers()
     {
-        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        if (!recordWorkers)
+        {
+            recordWorkers = std::make_unique<WorkerPool>(recordThreadCount);
+        }
+        recordedFrames.resize(std::size_t(MAX_FRAMES_IN_FLIGHT) * std::size(swapChainImages));
+        for (RecordedFrame& frame : recordedFrames)
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            KK_VERIFY_VK(vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffer));
+
+            // Parallel recording: each thread records into its own pool, no locking
+            frame.secondaryCommandPools.resize(recordWorkers->threadCount());
+            frame.secondaryCommandBuffers.resize(recordWorkers->threadCount());
+            for (unsigned thread = 0; thread < recordWorkers->threadCount(); ++thread)
+            {
+                VkCommandPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                poolInfo.queueFamilyIndex = graphicsQueueFamily;
+                KK_VERIFY_VK(vkCreateCommandPool(device, &poolInfo, nullptr, &frame.secondaryCommandPools[thread]));
+
+                VkCommandBufferAllocateInfo secondaryInfo{};
+                secondaryInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                secondaryInfo.commandPool = frame.secondaryCommandPools[thread];
+                secondaryInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                secondaryInfo.commandBufferCount = 1;
+                KK_VERIFY_VK(
+                    vkAllocateCommandBuffers(device, &secondaryInfo, &frame.secondaryCommandBuffers[thread]));
+            }
+        }
+    }
+
+    void destroyCommandBuffers()
+    {
+        for (RecordedFrame& frame : recordedFrames)
+        {
+            vkFreeCommandBuffers(device, commandPool, 1, &frame.commandBuffer);
+            for (VkCommandPool pool : frame.secondaryCommandPools)
+            {
+                vkDestroyCommandPool(device, pool, nullptr);
+            }
+        }
+        recordedFrames.clear();
+    }
 
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = uint32_t(commandBuffers.size());
-        KK_VERIFY_VK(vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()));
+    // Everything recordCommandBuffer() reads that ends up baked into the command buffers.
+    void updateFrameInputs(uint32_t imageIndex)
+    {
+        frameInputs.framebuffer = swapChainFramebuffers[imageIndex];
+        frameInputs.pipeline = currentGraphicsPipeline();
+        frameInputs.width = swapChainExtent.width;
+        frameInputs.height = swapChainExtent.height;
+        frameInputs.resourceGeneration = resourceGeneration;
+        frameInputs.threadCount = recordThreadCount;
+        frameInputs.gpuCulling = gpuCulling;
+        frameInputs.drawPerInstance = drawPerInstance;
+        frameInputs.instanceCount = visibleInstanceCount;
+        frameInputs.cullObjectCount = gpuCulling ? cullConstants.objectCount : 0;
+        frameInputs.drawViewProj = (drawPerInstance && !gpuCulling) ? viewProj : glm::mat4(1.0f);
+        frameInputs.uniformOffset = uniformOffset;
+        frameInputs.cullConstantsOffset = gpuCulling ? cullConstantsOffset : 0;
+        frameInputs.instances.assign(std::begin(visibleInstances), std::end(visibleInstances));
+        frameInputs.draws.assign(std::begin(visibleDraws), std::end(visibleDraws));
     }
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    void recordCommandBuffer(RecordedFrame& frame, uint32_t imageIndex)
     {
+        VkCommandBuffer commandBuffer = frame.commandBuffer;
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
         KK_VERIFY_VK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
+        if (gpuCulling)
+        {
+            recordCulling(commandBuffer);
+        }
+
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
         clearValues[1].depthStencil = {1.0f, 0};
@@ -1475,8 +7277,67 @@ private:
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        const std::size_t drawCount = frameDrawCount();
+        const unsigned threadCount = unsigned(std::clamp<std::size_t>(
+            drawCount / MIN_DRAWS_PER_RECORDING_THREAD, 1, std::min(recordThreadCount, recordWorkers->threadCount())));
+        if (threadCount == 1)
+        {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(commandBuffer, 0, drawCount);
+        }
+        else
+        {
+            // Contiguous draw ranges, one secondary command buffer per thread, executed in order.
+            recordWorkers->run(threadCount, [&](unsigned thread) {
+                recordSecondary(frame.secondaryCommandPools[thread], frame.secondaryCommandBuffers[thread], imageIndex,
+                    drawCount * thread / threadCount, drawCount * (thread + 1) / threadCount);
+            });
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(commandBuffer, threadCount, std::data(frame.secondaryCommandBuffers));
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+
+        KK_VERIFY_VK(vkEndCommandBuffer(commandBuffer));
+    }
+
+    // Draw calls this frame: an indirect draw, one per visible draw range, or one per (instance, range).
+    std::size_t frameDrawCount() const
+    {
+        if (gpuCulling)
+        {
+            return 1;
+        }
+        return std::size(visibleDraws) * (drawPerInstance ? visibleInstanceCount : 1);
+    }
+
+    void recordSecondary(VkCommandPool commandPool, VkCommandBuffer commandBuffer, uint32_t imageIndex,
+        std::size_t firstDraw, std::size_t lastDraw)
+    {
+        KK_VERIFY_VK(vkResetCommandPool(device, commandPool, 0));
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        // Not ONE_TIME_SUBMIT: the primary that executes it is resubmitted while its inputs are unchanged.
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        KK_VERIFY_VK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+        recordDraws(commandBuffer, firstDraw, lastDraw);
+        KK_VERIFY_VK(vkEndCommandBuffer(commandBuffer));
+    }
+
+    // State + draws [firstDraw, lastDraw) of frameDrawCount(), inside the render pass. Secondary command
+    // buffers inherit no state, so every range binds everything again.
+    void recordDraws(VkCommandBuffer commandBuffer, std::size_t firstDraw, std::size_t lastDraw)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameInputs.pipeline);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -1492,18 +7353,80 @@ private:
         scissor.extent = swapChainExtent;
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-            &descriptorSets[currentFrame], 0, nullptr);
+        const bool pushPerDraw = drawPerInstance && !gpuCulling;
+        VkBuffer instanceBuffer = gpuCulling ? objectTransformBuffer : instanceBuffers[currentFrame];
+        VkBuffer vertexBuffers[] = {vertexBuffer, pushPerDraw ? identityInstanceBuffer : instanceBuffer};
+        VkDeviceSize offsets[] = {0, 0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, mesh.indexType);
+        // Set 1, the texture table, has no dynamic offsets.
+        const std::array<VkDescriptorSet, 2> sets = {descriptorSet, textureTableSet};
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0,
+            bindlessTexturesSupported ? 2 : 1, sets.data(), 1, &frameInputs.uniformOffset);
+
+        DrawConstants constants{};
+        if (!pushPerDraw)
+        {
+            vkCmdPushConstants(
+                commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+        }
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(std::size(indices)), 1, 0, 0, 0);
+        if (gpuCulling)
+        {
+            cmdDrawIndexedIndirectCount(commandBuffer, indirectBuffers[currentFrame], INDIRECT_COMMANDS_OFFSET,
+                indirectBuffers[currentFrame], 0, maxIndirectDrawCount(), sizeof(VkDrawIndexedIndirectCommand));
+            return;
+        }
+        const std::size_t rangeCount = std::size(visibleDraws);
+        for (std::size_t i = firstDraw; i < lastDraw; ++i)
+        {
+            const MeshChunk& draw = visibleDraws[i % rangeCount];
+            if (pushPerDraw)
+            {
+                const uint32_t instance = frameInputs.instances[i / rangeCount];
+                constants.transform = frameInputs.drawViewProj * instanceTransforms[instance];
+                constants.material = instanceMaterials[instance];
+                constants.perDraw = 1;
+                vkCmdPushConstants(
+                    commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+                vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+            }
+            else
+            {
+                vkCmdDrawIndexed(
+                    commandBuffer, draw.indexCount, visibleInstanceCount, draw.firstIndex, draw.vertexOffset, 0);
+            }
+        }
+    }
 
-        vkCmdEndRenderPass(commandBuffer);
+    // Resets the draw count, runs cull.comp over all instances and makes its draws visible to the indirect draw.
+    void recordCulling(VkCommandBuffer commandBuffer)
+    {
+        VkBuffer indirectBuffer = indirectBuffers[currentFrame];
+        vkCmdFillBuffer(commandBuffer, indirectBuffer, 0, sizeof(uint32_t), 0);
 
-        KK_VERIFY_VK(vkEndCommandBuffer(commandBuffer));
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = indirectBuffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+            nullptr, 1, &barrier, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1,
+            &cullDescriptorSets[currentFrame], 1, &frameInputs.cullConstantsOffset);
+        vkCmdDispatch(commandBuffer, (cullConstants.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE,
+            std::max(maxLodDrawCount, 1u), 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr);
     }
 
     void createSyncObjects()
@@ -1527,7 +7450,7 @@ private:
         }
     }
 
-    void updateUniformBuffer(uint32_t currentImage)
+    void updateUniformBuffer()
     {
 #if (0)
         static auto startTime = std::chrono::high_resolution_clock::now();
@@ -1539,20 +7462,32 @@ private:
         float time = 1.0f;
 #endif
 
-        UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * rotation, glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj =
+        const glm::mat4 view =
+            glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f))
+            * glm::rotate(glm::mat4(1.0f), time * rotation, glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj =
             glm::perspective(glm::radians(45.0f), swapChainExtent.width / float(swapChainExtent.height), 0.1f, 10.0f);
-        ubo.proj[1][1] *= -1;
+        proj[1][1] *= -1;
+        viewProj = proj * view;
 
-        memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        UniformBufferObject ubo{};
+        ubo.viewProj = viewProj;
+        ubo.positionOffset = glm::vec4(mesh.quantization.positionOffset, 0.0f);
+        ubo.positionScale = glm::vec4(mesh.quantization.positionScale, 0.0f);
+        ubo.texCoordOffsetScale = glm::vec4(mesh.quantization.texCoordOffset, mesh.quantization.texCoordScale);
+        uniformRing.beginFrame(currentFrame);
+        const UniformRegion region = uniformRing.allocate(sizeof(ubo));
+        memcpy(region.data, &ubo, sizeof(ubo));
+        uniformOffset = region.offset;
+        cullScene(view, proj);
     }
 
     void drawFrame()
     {
         KK_VERIFY_VK(vkWaitForFences(
             device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX)); // wait for previous vkQueueSubmit
+        retirePipelines(false);
+        applyShaderReload();
 
         uint32_t imageIndex = 0;
         VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
@@ -1565,12 +7500,26 @@ private:
         }
         KK_VERIFY((result == VK_SUCCESS) || (result == VK_SUBOPTIMAL_KHR));
 
-        updateUniformBuffer(currentFrame);
+        const auto cpuStart = std::chrono::steady_clock::now();
+        updateUniformBuffer();
 
         KK_VERIFY_VK(vkResetFences(device, 1, &inFlightFences[currentFrame]));
 
-        KK_VERIFY_VK(vkResetCommandBuffer(commandBuffers[currentFrame], /*VkCommandBufferResetFlagBits*/ 0));
-        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        RecordedFrame& frame = recordedFrames[currentFrame * std::size(swapChainImages) + imageIndex];
+        updateFrameInputs(imageIndex);
+        if (reuseCommandBuffers && frame.valid && (frame.inputs == frameInputs))
+        {
+            ++framesReused;
+        }
+        else
+        {
+            KK_VERIFY_VK(vkResetCommandBuffer(frame.commandBuffer, /*VkCommandBufferResetFlagBits*/ 0));
+            recordCommandBuffer(frame, imageIndex);
+            frame.inputs = frameInputs;
+            frame.valid = true;
+            ++framesRecorded;
+        }
+        frameCpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - cpuStart).count();
 
         VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkPipelineStageFlags waitStages[] = {
@@ -1584,13 +7533,14 @@ private:
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
+        submitInfo.pCommandBuffers = &frame.commandBuffer;
         submitInfo.signalSemaphoreCount = 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         KK_VERIFY_VK(vkQueueSubmit(graphicsQueue, 1, &submitInfo,
             inFlightFences[currentFrame] // what to signal when command buffers finish execution
             ));
+        ++frameNumber;
 
         VkSwapchainKHR swapChains[] = {swapChain};
 
@@ -1713,19 +7663,9 @@ private:
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device)
     {
-        uint32_t extensionCount = 0;
-        KK_VERIFY_VK(vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr));
-        std::vector<VkExtensionProperties> availableExtensions;
-        availableExtensions.resize(extensionCount);
-        KK_VERIFY_VK(
-            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data()));
-
         for (std::string_view required_device_extension : kRequiredDeviceExtensions)
         {
-            const auto it = std::ranges::find(
-                availableExtensions, required_device_extension, &VkExtensionProperties::extensionName);
-            const bool found = (it != std::ranges::end(availableExtensions));
-            if (!found)
+            if (!isDeviceExtensionSupported(device, required_device_extension))
             {
                 return false;
             }
@@ -1733,6 +7673,41 @@ private:
         return true;
     }
 
+    // Everything the texture table needs: extensions and features; fills `features` with what the device has.
+    bool isDescriptorIndexingSupported(VkPhysicalDeviceDescriptorIndexingFeatures& features)
+    {
+        if (!physicalDeviceProperties2Supported
+            || !isDeviceExtensionSupported(physicalDevice, VK_KHR_MAINTENANCE_3_EXTENSION_NAME)
+            || !isDeviceExtensionSupported(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+        {
+            return false;
+        }
+        auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        KK_VERIFY(getFeatures2);
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &features;
+        getFeatures2(physicalDevice, &features2);
+        return features.shaderSampledImageArrayNonUniformIndexing
+            && features.descriptorBindingSampledImageUpdateAfterBind
+            && features.descriptorBindingUpdateUnusedWhilePending && features.descriptorBindingPartiallyBound
+            && features.runtimeDescriptorArray;
+    }
+
+    bool isDeviceExtensionSupported(VkPhysicalDevice device, std::string_view extension)
+    {
+        uint32_t extensionCount = 0;
+        KK_VERIFY_VK(vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr));
+        std::vector<VkExtensionProperties> availableExtensions;
+        availableExtensions.resize(extensionCount);
+        KK_VERIFY_VK(
+            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data()));
+
+        const auto it = std::ranges::find(availableExtensions, extension, &VkExtensionProperties::extensionName);
+        return (it != std::ranges::end(availableExtensions));
+    }
+
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device)
     {
         uint32_t queueFamilyCount = 0;
@@ -1764,6 +7739,16 @@ private:
             ++i;
         }
 
+        for (uint32_t family = 0; family < queueFamilyCount; ++family)
+        {
+            const VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+            {
+                indices.transferFamily = family;
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -1777,9 +7762,28 @@ private:
         {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
+        // Optional, to query descriptor indexing features on a Vulkan 1.0 instance.
+        physicalDeviceProperties2Supported =
+            isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        if (physicalDeviceProperties2Supported)
+        {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
         return extensions;
     }
 
+    static bool isInstanceExtensionSupported(std::string_view extension)
+    {
+        uint32_t extensionCount = 0;
+        KK_VERIFY_VK(vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr));
+        std::vector<VkExtensionProperties> availableExtensions;
+        availableExtensions.resize(extensionCount);
+        KK_VERIFY_VK(vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data()));
+
+        const auto it = std::ranges::find(availableExtensions, extension, &VkExtensionProperties::extensionName);
+        return (it != std::ranges::end(availableExtensions));
+    }
+
     bool checkValidationLayerSupport()
     {
         uint32_t layer_count = 0;
@@ -1854,8 +7858,314 @@ private:
     }
 };
 
-int main()
+// Compares vertex building paths on the given OBJ: one vertex per index (no dedup),
+// std::unordered_map dedup and VertexDeduplicator.
+int runDedupBenchmark(const char* objPath)
+{
+    tinyobj::attrib_t attrib{};
+    std::vector<tinyobj::shape_t> shapes;
+    KK_VERIFY(loadObj(objPath, attrib, shapes));
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Vertex& vertex) const
+        {
+            return VertexDeduplicator::hashKey(vertex);
+        }
+    };
+    struct KeyEqual
+    {
+        bool operator()(const Vertex& lhs, const Vertex& rhs) const
+        {
+            return VertexDeduplicator::sameKey(lhs, rhs);
+        }
+    };
+    auto buildWithUnorderedMap = [](const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                                     std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+        std::unordered_map<Vertex, uint32_t, KeyHash, KeyEqual> uniqueVertices;
+        for (const tinyobj::shape_t& shape : shapes)
+        {
+            for (const tinyobj::index_t& index : shape.mesh.indices)
+            {
+                const Vertex vertex = makeObjVertex(attrib, index);
+                auto [it, inserted] = uniqueVertices.try_emplace(vertex, uint32_t(vertices.size()));
+                if (inserted)
+                {
+                    vertices.push_back(vertex);
+                }
+                indices.push_back(it->second);
+            }
+        }
+    };
+
+    using BuildFunction = void (*)(const tinyobj::attrib_t&, const std::vector<tinyobj::shape_t>&,
+        std::vector<Vertex>&, std::vector<uint32_t>&);
+    const struct
+    {
+        const char* name;
+        BuildFunction build;
+    } paths[] = {
+        {"no dedup", &buildExpandedMesh},
+        {"std::unordered_map", buildWithUnorderedMap},
+        {"open addressing", &buildDedupedMesh},
+    };
+
+    const int kRuns = 5;
+    std::println("'{}': {} indices", objPath, countObjIndices(shapes));
+    for (const auto& path : paths)
+    {
+        double bestMs = std::numeric_limits<double>::max();
+        std::size_t vertexCount = 0;
+        for (int run = 0; run < kRuns; ++run)
+        {
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;
+            const auto start = std::chrono::steady_clock::now();
+            path.build(attrib, shapes, vertices, indices);
+            const auto end = std::chrono::steady_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+            vertexCount = vertices.size();
+        }
+        std::println(" -- {:<20} {:>10.3f} ms, {:>9} vertices, {:>10} vertex bytes", path.name, bestMs, vertexCount,
+            vertexCount * sizeof(Vertex));
+    }
+    return 0;
+}
+
+// tinyobj::LoadObj vs parseObj() with 1..maxThreads threads. The file is parsed from memory,
+// so the numbers exclude disk I/O for parseObj() (tinyobj reads through std::ifstream).
+int runObjParserBenchmark(const char* objPath, unsigned maxThreads)
+{
+    maxThreads = std::max(maxThreads, 1u);
+    MappedFile file;
+    KK_VERIFY(file.open(objPath));
+    const std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    const double sizeMB = double(text.size()) / (1024.0 * 1024.0);
+    const int kRuns = 3;
+
+    auto bestOf = [&](auto&& parse) {
+        double bestMs = std::numeric_limits<double>::max();
+        for (int run = 0; run < kRuns; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            parse();
+            const auto end = std::chrono::steady_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return bestMs;
+    };
+
+    std::println("'{}': {:.1f} MB", objPath, sizeMB);
+    tinyobj::attrib_t reference{};
+    std::vector<tinyobj::shape_t> referenceShapes;
+    const double tinyobjMs = bestOf([&]() {
+        reference = {};
+        referenceShapes.clear();
+        std::vector<tinyobj::material_t> materials;
+        std::string warn;
+        std::string err;
+        KK_VERIFY(tinyobj::LoadObj(&reference, &referenceShapes, &materials, &warn, &err, objPath));
+    });
+    std::println(" -- {:<12} {:>10.2f} ms, {:>8.1f} MB/s", "tinyobj", tinyobjMs, sizeMB * 1000.0 / tinyobjMs);
+
+    double singleThreadMs = 0.0;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads)
+    {
+        tinyobj::attrib_t attrib{};
+        std::vector<tinyobj::shape_t> shapes;
+        const double ms = bestOf([&]() { KK_VERIFY(parseObj(text, threads, attrib, shapes)); });
+        singleThreadMs = (threads == 1) ? ms : singleThreadMs;
+        const bool sameCounts = (attrib.vertices.size() == reference.vertices.size()) //
+                                && (attrib.texcoords.size() == reference.texcoords.size()) //
+                                && (countObjIndices(shapes) == countObjIndices(referenceShapes));
+        std::println(" -- {:>2} threads  {:>10.2f} ms, {:>8.1f} MB/s, {:>5.2f}x vs 1 thread, {:>5.2f}x vs tinyobj{}",
+            threads, ms, sizeMB * 1000.0 / ms, singleThreadMs / ms, tinyobjMs / ms,
+            sameCounts ? "" : " (MISMATCH with tinyobj)");
+    }
+    return 0;
+}
+
+// Frustum culling of `objectCount` random boxes with the scalar, SSE and AVX2 paths (whichever this build and
+// CPU have).
+// Boxes are scattered around a camera with a 60 degree field of view, so roughly 1/8 of them are visible.
+int runCullingBenchmark(uint32_t objectCount)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.5f, 5.0f);
+    AabbSoA boxes;
+    boxes.resize(objectCount);
+    for (uint32_t i = 0; i < objectCount; ++i)
+    {
+        const glm::vec3 boundsMin(position(random), position(random), position(random));
+        boxes.set(i, boundsMin, boundsMin + glm::vec3(size(random), size(random), size(random)));
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+    const Frustum frustum(proj * view);
+
+    using CullFunction = void (*)(const Frustum&, const AabbSoA&, uint8_t*);
+    struct CullPath
+    {
+        const char* name;
+        CullFunction cull;
+    };
+    std::vector<CullPath> paths = {{"scalar", &cullAabbsScalar}};
+#if (KK_HAS_SSE2)
+    paths.push_back({"SSE2 (4 wide)", &cullAabbsSse});
+#endif
+#if (KK_HAS_AVX2)
+    if (cpuSupportsAvx2())
+    {
+        paths.push_back({"AVX2 (8 wide)", &cullAabbsAvx2});
+    }
+#endif
+
+    const int kRuns = 20;
+    std::vector<uint8_t> visible(boxes.paddedCount());
+    std::size_t expectedVisible = 0;
+    std::println("{} boxes:", objectCount);
+    for (const auto& path : paths)
+    {
+        double bestMs = std::numeric_limits<double>::max();
+        for (int run = 0; run < kRuns; ++run)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            path.cull(frustum, boxes, visible.data());
+            const auto end = std::chrono::steady_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        const std::size_t visibleCount = std::size_t(std::count(visible.begin(), visible.begin() + objectCount, 1));
+        expectedVisible = (path.cull == &cullAabbsScalar) ? visibleCount : expectedVisible;
+        KK_VERIFY(visibleCount == expectedVisible);
+        std::println(" -- {:<14} {:>8.3f} ms, {:>6.2f} ns/box, {} visible", path.name, bestMs,
+            bestMs * 1e6 / double(std::max<uint32_t>(objectCount, 1)), visibleCount);
+    }
+    return 0;
+}
+
+// Offline texture baking: encodes `imagePath` into its texture cache with the given format
+// ("rgba8", "bc1", "bc3" or "bc7") and reports size, encode time and level 0 PSNR.
+int runTextureBakeTool(const char* imagePath, std::string_view formatName)
+{
+    const struct
+    {
+        std::string_view name;
+        VkFormat format;
+    } formats[] = {
+        {"rgba8", VK_FORMAT_R8G8B8A8_SRGB},
+        {"bc1", VK_FORMAT_BC1_RGB_SRGB_BLOCK},
+        {"bc3", VK_FORMAT_BC3_SRGB_BLOCK},
+        {"bc7", VK_FORMAT_BC7_SRGB_BLOCK},
+    };
+    auto it = std::find_if(
+        std::begin(formats), std::end(formats), [&](const auto& entry) { return (entry.name == formatName); });
+    if (it == std::end(formats))
+    {
+        std::println(stderr, "Unknown texture format '{}', expected rgba8, bc1, bc3 or bc7", formatName);
+        return 1;
+    }
+
+    MappedFile sourceFile;
+    KK_VERIFY(sourceFile.open(imagePath));
+    const uint64_t sourceHash = hashBytes(sourceFile.data(), sourceFile.size());
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels =
+        stbi_load_from_memory(sourceFile.data(), int(sourceFile.size()), &width, &height, &channels, STBI_rgb_alpha);
+    KK_VERIFY(pixels);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<unsigned char> file =
+        bakeTextureCache(pixels, uint32_t(width), uint32_t(height), sourceHash, it->format);
+    const auto end = std::chrono::steady_clock::now();
+
+    TextureCacheHeader header{};
+    KK_VERIFY(viewTextureCache(file, sourceHash, header));
+    std::vector<unsigned char> decoded(std::size_t(width) * height * 4);
+    KK_VERIFY(decodeTextureLevel(it->format, file.data() + header.levels[0].offset, header.width, header.height,
+        decoded.data()));
+    double squaredError = 0.0;
+    for (std::size_t i = 0; i < decoded.size(); ++i)
+    {
+        const double delta = double(decoded[i]) - double(pixels[i]);
+        squaredError += delta * delta;
+    }
+    stbi_image_free(pixels);
+    const double mse = squaredError / double(decoded.size());
+    const double psnr =
+        (mse > 0.0) ? (10.0 * std::log10((255.0 * 255.0) / mse)) : std::numeric_limits<double>::infinity();
+
+    const std::string cachePath = std::string(imagePath) + TEXTURE_CACHE_SUFFIX;
+    if (!writeFileAtomically(cachePath, file))
+    {
+        return 1;
+    }
+    TextureCacheHeader uncompressed = header;
+    uncompressed.format = VK_FORMAT_R8G8B8A8_SRGB;
+    uncompressed.layoutLevels();
+    std::println("'{}': {}x{}, {} mips -> '{}'", imagePath, width, height, header.levelCount, cachePath);
+    std::println(" -- {:<6} {:>10} KiB ({:.1f}% of RGBA8), {:>8.1f} ms, level 0 PSNR {:.2f} dB",
+        getTextureFormatInfo(it->format).name, header.payloadSize() / 1024,
+        100.0 * double(header.payloadSize()) / double(uncompressed.payloadSize()),
+        std::chrono::duration<double, std::milli>(end - start).count(), psnr);
+    return 0;
+}
+
+int main(int argc, char* argv[])
 {
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-dedup"))
+    {
+        return runDedupBenchmark((argc >= 3) ? argv[2] : MODEL_PATH);
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-obj"))
+    {
+        const unsigned maxThreads =
+            (argc >= 4) ? unsigned(std::atoi(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+        return runObjParserBenchmark((argc >= 3) ? argv[2] : MODEL_PATH, maxThreads);
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-uploads"))
+    {
+        HelloTriangleApplication app;
+        app.runUploadBenchmark((argc >= 3) ? uint32_t(std::atoi(argv[2])) : 16);
+        return 0;
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-instancing"))
+    {
+        HelloTriangleApplication app;
+        app.runInstancingBenchmark((argc >= 3) ? uint32_t(std::atoi(argv[2])) : 100000);
+        return 0;
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-pipeline-cache"))
+    {
+        HelloTriangleApplication app;
+        app.runPipelineCacheBenchmark();
+        return 0;
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-pipelines"))
+    {
+        HelloTriangleApplication app;
+        app.runPipelineVariantsBenchmark(
+            (argc >= 3) ? unsigned(std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency()));
+        return 0;
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-recording"))
+    {
+        HelloTriangleApplication app;
+        app.runRecordingBenchmark((argc >= 3) ? uint32_t(std::atoi(argv[2])) : 100000,
+            (argc >= 4) ? unsigned(std::atoi(argv[3])) : std::max(1u, std::thread::hardware_concurrency()));
+        return 0;
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bench-culling"))
+    {
+        return runCullingBenchmark((argc >= 3) ? uint32_t(std::atoi(argv[2])) : 100000);
+    }
+    if ((argc >= 2) && (std::string_view(argv[1]) == "--bake-texture"))
+    {
+        return runTextureBakeTool((argc >= 3) ? argv[2] : TEXTURE_PATH, (argc >= 4) ? argv[3] : "bc7");
+    }
+
     HelloTriangleApplication app;
     app.run();
 }
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Texture table (set 1): one sampled image per material ID, partially bound; see MATERIAL_TEXTURES.
+layout(set = 1, binding = 0) uniform sampler texSampler;
+layout(set = 1, binding = 1) uniform texture2D textures[];
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in uint fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Instances of one draw may use different materials.
+    outColor = texture(sampler2D(textures[nonuniformEXT(fragMaterial)], texSampler), fragTexCoord);
+}
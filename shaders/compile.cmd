@@ -14,3 +14,9 @@ call %MY_glslc% 26_shader_textures.vert -o vert_26.spv
 
 call %MY_glslc% 27_shader_depth.frag -o frag_27.spv
 call %MY_glslc% 27_shader_depth.vert -o vert_27.spv
+
+call %MY_glslc% packed_vertex.frag -o frag_packed.spv
+call %MY_glslc% packed_vertex.vert -o vert_packed.spv
+call %MY_glslc% bindless.frag -o frag_bindless.spv
+
+call %MY_glslc% cull.comp -o comp_cull.spv
@@ -0,0 +1,38 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 viewProj;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 texCoordOffsetScale;
+} ubo;
+
+// Recorded per draw. Instanced and GPU-culled draws push perDraw = 0 and take the camera from the UBO, so their
+// command buffers stay valid as it moves; draws with an identity instance transform push their whole MVP.
+layout(push_constant) uniform DrawConstants {
+    mat4 transform; // projection * view * model when perDraw != 0
+    uint material;  // added to instanceMaterial: the material of draws with an identity instance, 0 otherwise
+    uint perDraw;
+} draw;
+
+// R16G16B16A16_UNORM / R16G16_UNORM: [0, 1] within the mesh position and texCoord bounds.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+// Per-instance stream (VK_VERTEX_INPUT_RATE_INSTANCE), one column per location 2..5.
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in uint instanceMaterial;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) flat out uint fragMaterial;
+
+void main() {
+    vec3 position = ubo.positionOffset.xyz + ubo.positionScale.xyz * inPosition;
+    vec4 worldPosition = instanceModel * vec4(position, 1.0);
+    if (draw.perDraw != 0u) {
+        gl_Position = draw.transform * worldPosition;
+    } else {
+        gl_Position = ubo.viewProj * worldPosition;
+    }
+    fragTexCoord = ubo.texCoordOffsetScale.xy + ubo.texCoordOffsetScale.zw * inTexCoord;
+    fragMaterial = instanceMaterial + draw.material;
+}